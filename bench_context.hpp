@@ -0,0 +1,63 @@
+#pragma once
+
+/* Adds the build configuration and the CPU model to google-benchmark's context (console header
+ * and JSON output), where `bench_history record` picks them up. Compile flags and the git
+ * revision are only known if they are passed in, e.g.
+ * `-DBENCH_FLAGS="\"-O3 -march=native\"" -DBENCH_GIT="\"$(git describe --always --dirty)\""`. */
+
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <string>
+
+#ifndef BENCH_FLAGS
+#define BENCH_FLAGS ""
+#endif
+
+#ifndef BENCH_GIT
+#define BENCH_GIT ""
+#endif
+
+/* The "model name" of the first CPU in /proc/cpuinfo, empty if there is none */
+inline std::string bench_cpu_model()
+{
+        std::ifstream in("/proc/cpuinfo");
+        for(std::string line; std::getline(in, line);)
+        {
+                if(!line.starts_with("model name"))
+                {
+                        continue;
+                }
+                const auto pos = line.find_first_not_of(" \t", line.find(':') + 1);
+                return pos == std::string::npos ? "" : line.substr(pos);
+        }
+        return "";
+}
+
+static const bool bench_context_registered = []()
+{
+#if defined(__clang__)
+        benchmark::AddCustomContext("compiler", "clang " __clang_version__);
+#elif defined(__GNUC__)
+        benchmark::AddCustomContext("compiler", "gcc " __VERSION__);
+#endif
+
+#if defined(_LIBCPP_VERSION)
+        benchmark::AddCustomContext("stdlib", "libc++ " + std::to_string(_LIBCPP_VERSION));
+#elif defined(__GLIBCXX__)
+        benchmark::AddCustomContext("stdlib", "libstdc++ " + std::to_string(__GLIBCXX__));
+#endif
+
+        if(*BENCH_FLAGS != '\0')
+        {
+                benchmark::AddCustomContext("flags", BENCH_FLAGS);
+        }
+        if(*BENCH_GIT != '\0')
+        {
+                benchmark::AddCustomContext("git", BENCH_GIT);
+        }
+        if(const auto cpu = bench_cpu_model(); !cpu.empty())
+        {
+                benchmark::AddCustomContext("cpu", cpu);
+        }
+        return true;
+}();
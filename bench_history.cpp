@@ -0,0 +1,431 @@
+/* Local benchmark history with regression detection.
+ *
+ * usage: bench_history record [options] <binary|results.json> [--benchmark_...]
+ *        bench_history check [options]
+ *
+ * `record` runs a benchmark binary with repetitions (or reads its JSON output) and appends one
+ * JSON line per benchmark to the history file, together with the compiler, standard library,
+ * compile flags, CPU model, host and git revision it was measured with. All of them come from
+ * the benchmark context (see bench_context.hpp), not from the machine doing the recording;
+ * compiler, flags and revision can be given explicitly. Nothing is recorded if the flags, the
+ * revision or the host are unknown: runs with a wrong configuration would be compared with
+ * unrelated ones. Without a "cpu" entry in the context, the CPU is described by its count and
+ * clock as reported by google-benchmark.
+ *
+ * `check` compares the newest run of every configuration (benchmark, executable, flags, CPU and
+ * host) against the repetitions of its previous N runs and reports the slowdowns that are both
+ * statistically significant (Mann-Whitney U test, bootstrap CI of the median change above 0)
+ * and larger than a threshold. Exits with 2 if any regression is found.
+ *
+ * options:
+ *   --db=FILE          history file (default: bench_history.jsonl)
+ *   --repetitions=N    record: repetitions per benchmark (default: 10)
+ *   --compiler=STR     record: override the compiler
+ *   --flags=STR        record: override the compile flags
+ *   --git=STR          record: override the git revision
+ *   --last=N           check: number of previous runs to compare against (default: 5)
+ *   --alpha=X          check: significance level (default: 0.01)
+ *   --threshold=X      check: minimum relative slowdown of the median (default: 0.02) */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench_report.hpp"
+#include "bench_stats.hpp"
+
+struct options
+{
+        std::string db = "bench_history.jsonl";
+        std::size_t repetitions = 10;
+        std::string compiler;
+        std::string flags;
+        std::string git;
+        std::size_t last = 5;
+        double alpha = 0.01;
+        double threshold = 0.02;
+        std::vector<std::string> benchmark_args;
+        std::vector<std::string> positional;
+};
+
+struct history_record
+{
+        std::string timestamp;
+        std::string benchmark;
+        std::string executable;
+        std::string host;
+        std::string cpu;
+        std::string compiler;
+        std::string stdlib;
+        std::string flags;
+        std::string git;
+        std::string time_unit;
+        std::vector<double> real_time;
+        std::vector<double> cpu_time;
+
+        /* runs with the same configuration are comparable; compiler, library and git revision are
+         * deliberately not part of it, they are what changes between runs */
+        std::string configuration() const
+        {
+                return benchmark + '\n' + executable + '\n' + flags + '\n' + cpu + '\n' + host;
+        }
+};
+
+/* The CPU the benchmark ran on: bench_context.hpp's model name, or google-benchmark's own
+ * description */
+static std::string context_cpu(const json_value& ctx)
+{
+        if(const auto cpu = ctx["cpu"].string_or(""); !cpu.empty())
+        {
+                return cpu;
+        }
+        const auto cpus = ctx["num_cpus"].number_or(0);
+        const auto mhz = ctx["mhz_per_cpu"].number_or(0);
+        if(cpus <= 0 || mhz <= 0)
+        {
+                return "";
+        }
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.0f x %.0f MHz", cpus, mhz);
+        return buf;
+}
+
+static std::string utc_timestamp()
+{
+        const auto now = std::time(nullptr);
+        std::tm tm;
+        ::gmtime_r(&now, &tm);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        return buf;
+}
+
+static std::string basename_of(const std::string& path)
+{
+        const auto pos = path.rfind('/');
+        return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+static std::string to_json(const history_record& rec)
+{
+        /* JSON has no NaN or infinity: those are written as null, and read back as NaN */
+        const auto numbers = [](const std::vector<double>& values)
+        {
+                std::string out = "[";
+                for(std::size_t i = 0; i < values.size(); ++i)
+                {
+                        out += i == 0 ? "" : ",";
+                        if(!std::isfinite(values[i]))
+                        {
+                                out += "null";
+                                continue;
+                        }
+                        char buf[32];
+                        std::snprintf(buf, sizeof(buf), "%.17g", values[i]);
+                        out += buf;
+                }
+                return out + ']';
+        };
+
+        return "{\"timestamp\":" + json_quote(rec.timestamp) +
+               ",\"benchmark\":" + json_quote(rec.benchmark) +
+               ",\"executable\":" + json_quote(rec.executable) +
+               ",\"host\":" + json_quote(rec.host) + ",\"cpu\":" + json_quote(rec.cpu) +
+               ",\"compiler\":" + json_quote(rec.compiler) +
+               ",\"stdlib\":" + json_quote(rec.stdlib) + ",\"flags\":" + json_quote(rec.flags) +
+               ",\"git\":" + json_quote(rec.git) + ",\"time_unit\":" + json_quote(rec.time_unit) +
+               ",\"real_time\":" + numbers(rec.real_time) +
+               ",\"cpu_time\":" + numbers(rec.cpu_time) + "}";
+}
+
+static std::optional<history_record> from_json(const json_value& obj)
+{
+        if(obj.type != json_value::kind::object ||
+           obj["benchmark"].type != json_value::kind::string)
+        {
+                return std::nullopt;
+        }
+
+        const auto numbers = [](const json_value& arr)
+        {
+                std::vector<double> out;
+                for(const auto& v : arr.elements)
+                {
+                        out.push_back(v.number_or(NAN));
+                }
+                return out;
+        };
+
+        history_record rec;
+        rec.timestamp = obj["timestamp"].string_or("");
+        rec.benchmark = obj["benchmark"].string_or("");
+        rec.executable = obj["executable"].string_or("");
+        rec.host = obj["host"].string_or("");
+        rec.cpu = obj["cpu"].string_or("");
+        rec.compiler = obj["compiler"].string_or("");
+        rec.stdlib = obj["stdlib"].string_or("");
+        rec.flags = obj["flags"].string_or("");
+        rec.git = obj["git"].string_or("");
+        rec.time_unit = obj["time_unit"].string_or("ns");
+        rec.real_time = numbers(obj["real_time"]);
+        rec.cpu_time = numbers(obj["cpu_time"]);
+        return rec;
+}
+
+static int record(const options& opts)
+{
+        const auto& source = opts.positional[1];
+        auto args = opts.benchmark_args;
+        args.push_back("--benchmark_repetitions=" + std::to_string(opts.repetitions));
+
+        const auto report = load_benchmark_report(source, args);
+        if(!report)
+        {
+                std::fprintf(stderr, "bench_history: could not get benchmark results from '%s'\n",
+                             source.c_str());
+                return 1;
+        }
+
+        const auto& ctx = report->context;
+        history_record base;
+        base.timestamp = utc_timestamp();
+        base.executable = basename_of(ctx["executable"].string_or(source));
+        base.host = ctx["host_name"].string_or("");
+        base.cpu = context_cpu(ctx);
+        base.compiler =
+            !opts.compiler.empty() ? opts.compiler : ctx["compiler"].string_or("unknown");
+        base.stdlib = ctx["stdlib"].string_or("unknown");
+        base.flags = !opts.flags.empty() ? opts.flags : ctx["flags"].string_or("");
+        base.git = !opts.git.empty() ? opts.git : ctx["git"].string_or("");
+
+        const char* missing = nullptr;
+        if(base.flags.empty())
+        {
+                missing = "compile flags (--flags or BENCH_FLAGS)";
+        }
+        else if(base.git.empty())
+        {
+                missing = "git revision (--git or BENCH_GIT)";
+        }
+        else if(base.host.empty())
+        {
+                missing = "host name";
+        }
+        else if(base.cpu.empty())
+        {
+                missing = "CPU";
+        }
+        if(missing != nullptr)
+        {
+                std::fprintf(stderr, "bench_history: %s of '%s' unknown, not recording\n", missing,
+                             source.c_str());
+                return 1;
+        }
+
+        std::FILE* db = std::fopen(opts.db.c_str(), "a");
+        if(db == nullptr)
+        {
+                std::fprintf(stderr, "bench_history: cannot open '%s'\n", opts.db.c_str());
+                return 1;
+        }
+
+        for(const auto& run : report->runs)
+        {
+                auto rec = base;
+                rec.benchmark = run.name;
+                rec.time_unit = run.time_unit;
+                rec.real_time = run.real_time;
+                rec.cpu_time = run.cpu_time;
+                std::fprintf(db, "%s\n", to_json(rec).c_str());
+        }
+
+        const bool ok = std::fclose(db) == 0;
+        std::fprintf(stderr, "bench_history: recorded %zu benchmarks of %s (%s, %s) in %s\n",
+                     report->runs.size(), base.executable.c_str(), base.compiler.c_str(),
+                     base.git.c_str(), opts.db.c_str());
+        return ok ? 0 : 1;
+}
+
+static int check(const options& opts)
+{
+        std::ifstream in(opts.db);
+        if(!in)
+        {
+                std::fprintf(stderr, "bench_history: cannot open '%s'\n", opts.db.c_str());
+                return 1;
+        }
+
+        /* file order is chronological, it is append-only */
+        std::map<std::string, std::vector<history_record>> by_config;
+        std::size_t line_no = 0;
+        for(std::string line; std::getline(in, line);)
+        {
+                ++line_no;
+                if(line.empty())
+                {
+                        continue;
+                }
+                const auto obj = parse_json(line);
+                auto rec = obj ? from_json(*obj) : std::nullopt;
+                if(!rec)
+                {
+                        std::fprintf(stderr, "bench_history: %s:%zu: skipping malformed record\n",
+                                     opts.db.c_str(), line_no);
+                        continue;
+                }
+                by_config[rec->configuration()].push_back(std::move(*rec));
+        }
+
+        std::size_t regressions = 0;
+        std::size_t checked = 0;
+        for(const auto& [config, runs] : by_config)
+        {
+                if(runs.size() < 2)
+                {
+                        continue;
+                }
+
+                /* samples recorded as null (NaN) carry no timing and are left out */
+                const auto append_finite = [](std::vector<double>& out,
+                                              const history_record& run)
+                {
+                        std::copy_if(run.real_time.begin(), run.real_time.end(),
+                                     std::back_inserter(out),
+                                     [](const double t) { return std::isfinite(t); });
+                };
+
+                const auto& newest = runs.back();
+                const auto first = runs.size() - 1 - std::min(opts.last, runs.size() - 1);
+                std::vector<double> baseline;
+                for(auto i = first; i + 1 < runs.size(); ++i)
+                {
+                        append_finite(baseline, runs[i]);
+                }
+                std::vector<double> latest;
+                append_finite(latest, newest);
+                if(baseline.empty() || latest.empty())
+                {
+                        continue;
+                }
+                ++checked;
+
+                const auto change = median(latest) / median(baseline) - 1;
+                const auto ci = bootstrap_relative_change(baseline, latest);
+                const auto test = mann_whitney_u(baseline, latest);
+                if(!(test.p_value < opts.alpha && ci.lower > 0 && change > opts.threshold))
+                {
+                        continue;
+                }
+
+                ++regressions;
+                const auto& previous = runs[runs.size() - 2];
+                std::printf("REGRESSION %s (%s)\n"
+                            "  median %+.2f%%, 95%% CI [%+.2f%%, %+.2f%%], p = %.4g, vs. last %zu "
+                            "runs\n"
+                            "  new: %s %s, %s, %s\n"
+                            "  old: %s %s, %s, %s\n",
+                            newest.benchmark.c_str(), newest.executable.c_str(), change * 100,
+                            ci.lower * 100, ci.upper * 100, test.p_value, runs.size() - 1 - first,
+                            newest.timestamp.c_str(), newest.git.c_str(), newest.compiler.c_str(),
+                            newest.stdlib.c_str(), previous.timestamp.c_str(),
+                            previous.git.c_str(), previous.compiler.c_str(),
+                            previous.stdlib.c_str());
+        }
+
+        std::printf("%zu regression(s) in %zu configuration(s) with history\n", regressions,
+                    checked);
+        return regressions == 0 ? 0 : 2;
+}
+
+static bool parse_options(const int argc, char** argv, options& opts)
+{
+        for(int i = 1; i < argc; ++i)
+        {
+                const std::string_view arg = argv[i];
+                const auto value = [&arg]()
+                {
+                        return std::string(arg.substr(arg.find('=') + 1));
+                };
+
+                if(arg.starts_with("--db="))
+                {
+                        opts.db = value();
+                }
+                else if(arg.starts_with("--repetitions="))
+                {
+                        opts.repetitions = std::strtoul(value().c_str(), nullptr, 10);
+                }
+                else if(arg.starts_with("--compiler="))
+                {
+                        opts.compiler = value();
+                }
+                else if(arg.starts_with("--flags="))
+                {
+                        opts.flags = value();
+                }
+                else if(arg.starts_with("--git="))
+                {
+                        opts.git = value();
+                }
+                else if(arg.starts_with("--last="))
+                {
+                        opts.last = std::strtoul(value().c_str(), nullptr, 10);
+                }
+                else if(arg.starts_with("--alpha="))
+                {
+                        opts.alpha = std::strtod(value().c_str(), nullptr);
+                }
+                else if(arg.starts_with("--threshold="))
+                {
+                        opts.threshold = std::strtod(value().c_str(), nullptr);
+                }
+                else if(arg.starts_with("--benchmark_"))
+                {
+                        opts.benchmark_args.emplace_back(arg);
+                }
+                else if(arg.starts_with("--"))
+                {
+                        return false;
+                }
+                else
+                {
+                        opts.positional.emplace_back(arg);
+                }
+        }
+
+        if(opts.positional.empty() || opts.repetitions == 0 || opts.last == 0)
+        {
+                return false;
+        }
+        const auto& mode = opts.positional.front();
+        return (mode == "record" && opts.positional.size() == 2) ||
+               (mode == "check" && opts.positional.size() == 1);
+}
+
+int
+main(int argc, char** argv)
+{
+        options opts;
+        if(!parse_options(argc, argv, opts))
+        {
+                std::fprintf(stderr,
+                             "usage: %s record [--db=FILE] [--repetitions=N] [--compiler=STR] "
+                             "[--flags=STR] [--git=STR] <binary|results.json> [--benchmark_...]\n"
+                             "       %s check [--db=FILE] [--last=N] [--alpha=X] "
+                             "[--threshold=X]\n",
+                             argv[0], argv[0]);
+                return 1;
+        }
+
+        return opts.positional[0] == "record" ? record(opts) : check(opts);
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+/* Just enough JSON to read google-benchmark's `--benchmark_format=json` output and to write the
+ * flat records of the benchmark history file. No exceptions: parse errors yield `std::nullopt`. */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class json_value
+{
+public:
+        enum class kind
+        {
+                null,
+                boolean,
+                number,
+                string,
+                array,
+                object,
+        };
+
+        kind type = kind::null;
+        bool boolean = false;
+        double number = 0;
+        std::string string;
+        std::vector<json_value> elements; /* array elements or object values */
+        std::vector<std::string> keys;    /* object keys, parallel to `elements` */
+
+        /* Member `key` of an object, or a null value */
+        const json_value& operator[](const std::string_view key) const
+        {
+                static const json_value null_value;
+                for(std::size_t i = 0; i < keys.size(); ++i)
+                {
+                        if(keys[i] == key)
+                        {
+                                return elements[i];
+                        }
+                }
+                return null_value;
+        }
+
+        bool is_null() const
+        {
+                return type == kind::null;
+        }
+
+        double number_or(const double fallback) const
+        {
+                return type == kind::number ? number : fallback;
+        }
+
+        std::string string_or(std::string fallback) const
+        {
+                return type == kind::string ? string : fallback;
+        }
+};
+
+class json_parser
+{
+public:
+        explicit json_parser(const std::string_view text)
+            : text_(text)
+        {
+        }
+
+        std::optional<json_value> parse()
+        {
+                json_value value;
+                if(!parse_value(value, 0))
+                {
+                        return std::nullopt;
+                }
+                skip_ws();
+                if(pos_ != text_.size())
+                {
+                        return std::nullopt;
+                }
+                return value;
+        }
+
+private:
+        static constexpr unsigned MAX_DEPTH = 256;
+
+        std::string_view text_;
+        std::size_t pos_ = 0;
+
+        void skip_ws()
+        {
+                while(pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' ||
+                                              text_[pos_] == '\n' || text_[pos_] == '\r'))
+                {
+                        ++pos_;
+                }
+        }
+
+        bool consume(const char c)
+        {
+                skip_ws();
+                if(pos_ < text_.size() && text_[pos_] == c)
+                {
+                        ++pos_;
+                        return true;
+                }
+                return false;
+        }
+
+        bool consume_literal(const std::string_view literal)
+        {
+                if(text_.substr(pos_, literal.size()) != literal)
+                {
+                        return false;
+                }
+                pos_ += literal.size();
+                return true;
+        }
+
+        bool parse_value(json_value& out, const unsigned depth)
+        {
+                skip_ws();
+                if(pos_ == text_.size() || depth > MAX_DEPTH)
+                {
+                        return false;
+                }
+
+                switch(text_[pos_])
+                {
+                case '{':
+                        return parse_object(out, depth);
+                case '[':
+                        return parse_array(out, depth);
+                case '"':
+                        out.type = json_value::kind::string;
+                        return parse_string(out.string);
+                case 't':
+                        out.type = json_value::kind::boolean;
+                        out.boolean = true;
+                        return consume_literal("true");
+                case 'f':
+                        out.type = json_value::kind::boolean;
+                        out.boolean = false;
+                        return consume_literal("false");
+                case 'n':
+                        out.type = json_value::kind::null;
+                        return consume_literal("null");
+                default:
+                        out.type = json_value::kind::number;
+                        return parse_number(out.number);
+                }
+        }
+
+        bool parse_object(json_value& out, const unsigned depth)
+        {
+                out.type = json_value::kind::object;
+                ++pos_;
+                if(consume('}'))
+                {
+                        return true;
+                }
+
+                do
+                {
+                        skip_ws();
+                        std::string key;
+                        if(pos_ == text_.size() || text_[pos_] != '"' || !parse_string(key) ||
+                           !consume(':'))
+                        {
+                                return false;
+                        }
+
+                        json_value value;
+                        if(!parse_value(value, depth + 1))
+                        {
+                                return false;
+                        }
+                        out.keys.push_back(std::move(key));
+                        out.elements.push_back(std::move(value));
+                } while(consume(','));
+
+                return consume('}');
+        }
+
+        bool parse_array(json_value& out, const unsigned depth)
+        {
+                out.type = json_value::kind::array;
+                ++pos_;
+                if(consume(']'))
+                {
+                        return true;
+                }
+
+                do
+                {
+                        json_value value;
+                        if(!parse_value(value, depth + 1))
+                        {
+                                return false;
+                        }
+                        out.elements.push_back(std::move(value));
+                } while(consume(','));
+
+                return consume(']');
+        }
+
+        bool parse_number(double& out)
+        {
+                const auto first = pos_;
+                while(pos_ < text_.size() &&
+                      std::string_view("+-0123456789.eE").find(text_[pos_]) != std::string_view::npos)
+                {
+                        ++pos_;
+                }
+                if(first == pos_)
+                {
+                        return false;
+                }
+
+                const std::string str(text_.substr(first, pos_ - first));
+                char* end = nullptr;
+                out = std::strtod(str.c_str(), &end);
+                return end == str.c_str() + str.size();
+        }
+
+        bool parse_hex4(std::uint32_t& out)
+        {
+                if(text_.size() - pos_ < 4)
+                {
+                        return false;
+                }
+
+                out = 0;
+                for(std::size_t i = 0; i < 4; ++i)
+                {
+                        const char c = text_[pos_++];
+                        out <<= 4;
+                        if(c >= '0' && c <= '9')
+                        {
+                                out |= std::uint32_t(c - '0');
+                        }
+                        else if(c >= 'a' && c <= 'f')
+                        {
+                                out |= std::uint32_t(c - 'a' + 10);
+                        }
+                        else if(c >= 'A' && c <= 'F')
+                        {
+                                out |= std::uint32_t(c - 'A' + 10);
+                        }
+                        else
+                        {
+                                return false;
+                        }
+                }
+                return true;
+        }
+
+        static void append_utf8(std::string& out, const std::uint32_t cp)
+        {
+                if(cp < 0x80)
+                {
+                        out += char(cp);
+                }
+                else if(cp < 0x800)
+                {
+                        out += char(0xc0 | (cp >> 6));
+                        out += char(0x80 | (cp & 0x3f));
+                }
+                else if(cp < 0x10000)
+                {
+                        out += char(0xe0 | (cp >> 12));
+                        out += char(0x80 | ((cp >> 6) & 0x3f));
+                        out += char(0x80 | (cp & 0x3f));
+                }
+                else
+                {
+                        out += char(0xf0 | (cp >> 18));
+                        out += char(0x80 | ((cp >> 12) & 0x3f));
+                        out += char(0x80 | ((cp >> 6) & 0x3f));
+                        out += char(0x80 | (cp & 0x3f));
+                }
+        }
+
+        bool parse_string(std::string& out)
+        {
+                ++pos_;
+                while(pos_ < text_.size())
+                {
+                        const char c = text_[pos_++];
+                        if(c == '"')
+                        {
+                                return true;
+                        }
+                        if(c != '\\')
+                        {
+                                out += c;
+                                continue;
+                        }
+                        if(pos_ == text_.size())
+                        {
+                                return false;
+                        }
+
+                        switch(const char esc = text_[pos_++]; esc)
+                        {
+                        case '"':
+                        case '\\':
+                        case '/':
+                                out += esc;
+                                break;
+                        case 'b':
+                                out += '\b';
+                                break;
+                        case 'f':
+                                out += '\f';
+                                break;
+                        case 'n':
+                                out += '\n';
+                                break;
+                        case 'r':
+                                out += '\r';
+                                break;
+                        case 't':
+                                out += '\t';
+                                break;
+                        case 'u':
+                        {
+                                std::uint32_t cp;
+                                if(!parse_hex4(cp))
+                                {
+                                        return false;
+                                }
+                                /* surrogate pair */
+                                if(cp >= 0xd800 && cp < 0xdc00 && consume_literal("\\u"))
+                                {
+                                        std::uint32_t low;
+                                        if(!parse_hex4(low) || low < 0xdc00 || low >= 0xe000)
+                                        {
+                                                return false;
+                                        }
+                                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                                }
+                                append_utf8(out, cp);
+                                break;
+                        }
+                        default:
+                                return false;
+                        }
+                }
+                return false;
+        }
+};
+
+inline std::optional<json_value> parse_json(const std::string_view text)
+{
+        return json_parser{text}.parse();
+}
+
+/* `str` as a quoted JSON string */
+inline std::string json_quote(const std::string_view str)
+{
+        std::string out = "\"";
+        for(const char c : str)
+        {
+                switch(c)
+                {
+                case '"':
+                        out += "\\\"";
+                        break;
+                case '\\':
+                        out += "\\\\";
+                        break;
+                case '\n':
+                        out += "\\n";
+                        break;
+                case '\r':
+                        out += "\\r";
+                        break;
+                case '\t':
+                        out += "\\t";
+                        break;
+                default:
+                        if(static_cast<unsigned char>(c) < 0x20)
+                        {
+                                char buf[8];
+                                std::snprintf(buf, sizeof(buf), "\\u%04x", unsigned(c));
+                                out += buf;
+                        }
+                        else
+                        {
+                                out += c;
+                        }
+                }
+        }
+        out += '"';
+        return out;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+/* Loading google-benchmark results, either from a `--benchmark_format=json` file or by running a
+ * benchmark binary. */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_json.hpp"
+
+extern char** environ;
+
+/* All repetitions of one benchmark (e.g. `assume_element_type/1024`) */
+struct benchmark_run
+{
+        std::string name;
+        std::string time_unit;
+        std::vector<double> real_time;
+        std::vector<double> cpu_time;
+};
+
+struct benchmark_report
+{
+        json_value context;
+        std::vector<benchmark_run> runs;
+};
+
+inline std::optional<std::string> read_file(const std::string& path)
+{
+        std::ifstream in(path, std::ios::binary);
+        if(!in)
+        {
+                return std::nullopt;
+        }
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        return std::move(ss).str();
+}
+
+/* Runs `argv` (searched in PATH) and returns its stdout; stderr is passed through */
+inline std::optional<std::string> run_and_capture(const std::vector<std::string>& argv)
+{
+        int fds[2];
+        if(argv.empty() || ::pipe(fds) != 0)
+        {
+                return std::nullopt;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, fds[0]);
+        posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+        std::vector<char*> cargv;
+        for(const auto& arg : argv)
+        {
+                cargv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        cargv.push_back(nullptr);
+
+        pid_t pid;
+        const int err =
+            posix_spawnp(&pid, cargv[0], &actions, nullptr, cargv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        ::close(fds[1]);
+        if(err != 0)
+        {
+                ::close(fds[0]);
+                return std::nullopt;
+        }
+
+        std::string out;
+        char buf[1 << 16];
+        for(ssize_t n; (n = ::read(fds[0], buf, sizeof(buf))) != 0;)
+        {
+                if(n < 0)
+                {
+                        if(errno == EINTR)
+                        {
+                                continue;
+                        }
+                        break;
+                }
+                out.append(buf, std::size_t(n));
+        }
+        ::close(fds[0]);
+
+        int status;
+        while(::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+                return std::nullopt;
+        }
+        return out;
+}
+
+inline std::optional<benchmark_report> parse_benchmark_report(const std::string_view text)
+{
+        auto root = parse_json(text);
+        if(!root || (*root)["benchmarks"].type != json_value::kind::array)
+        {
+                return std::nullopt;
+        }
+
+        benchmark_report report;
+        report.context = (*root)["context"];
+        for(const auto& entry : (*root)["benchmarks"].elements)
+        {
+                /* skip the mean/median/stddev aggregates, they are recomputed from the runs */
+                if(entry["run_type"].string_or("iteration") != "iteration")
+                {
+                        continue;
+                }
+
+                const auto name = entry["run_name"].string_or(entry["name"].string_or(""));
+                auto it = std::find_if(report.runs.begin(), report.runs.end(),
+                                       [&name](const benchmark_run& run)
+                                       {
+                                               return run.name == name;
+                                       });
+                if(it == report.runs.end())
+                {
+                        report.runs.push_back({name, entry["time_unit"].string_or("ns"), {}, {}});
+                        it = report.runs.end() - 1;
+                }
+                it->real_time.push_back(entry["real_time"].number_or(NAN));
+                it->cpu_time.push_back(entry["cpu_time"].number_or(NAN));
+        }
+        return report;
+}
+
+/* `source` is either a JSON file written with `--benchmark_out_format=json` (or
+ * `--benchmark_format=json`), or a benchmark binary, which is then run with `args` plus the
+ * flags needed to get JSON on stdout. */
+inline std::optional<benchmark_report> load_benchmark_report(const std::string& source,
+                                                             const std::vector<std::string>& args)
+{
+        if(::access(source.c_str(), X_OK) != 0 || source.ends_with(".json"))
+        {
+                const auto text = read_file(source);
+                return text ? parse_benchmark_report(*text) : std::nullopt;
+        }
+
+        /* a bare file name would otherwise be looked up in PATH */
+        std::vector<std::string> argv = {source.find('/') == std::string::npos ? "./" + source
+                                                                                : source};
+        argv.insert(argv.end(), args.begin(), args.end());
+        argv.push_back("--benchmark_format=json");
+        const auto text = run_and_capture(argv);
+        return text ? parse_benchmark_report(*text) : std::nullopt;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+/* Statistics over repeated benchmark measurements */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+inline double median(std::vector<double> values)
+{
+        if(values.empty())
+        {
+                return NAN;
+        }
+
+        const auto mid = values.size() / 2;
+        std::nth_element(values.begin(), values.begin() + mid, values.end());
+        if(values.size() % 2 != 0)
+        {
+                return values[mid];
+        }
+        const auto lower = *std::max_element(values.begin(), values.begin() + mid);
+        return (lower + values[mid]) / 2;
+}
+
+inline double mean(const std::span<const double> values)
+{
+        double sum = 0;
+        for(const auto v : values)
+        {
+                sum += v;
+        }
+        return values.empty() ? NAN : sum / double(values.size());
+}
+
+/* Sample standard deviation divided by the mean */
+inline double coefficient_of_variation(const std::span<const double> values)
+{
+        if(values.size() < 2)
+        {
+                return 0;
+        }
+
+        const auto m = mean(values);
+        double sq = 0;
+        for(const auto v : values)
+        {
+                sq += (v - m) * (v - m);
+        }
+        return std::sqrt(sq / double(values.size() - 1)) / m;
+}
+
+struct confidence_interval
+{
+        double lower;
+        double upper;
+};
+
+/* Percentile bootstrap interval for `median(contender) / median(baseline) - 1`. The resampling
+ * generator is seeded with a constant so that reports are reproducible. */
+inline confidence_interval bootstrap_relative_change(const std::span<const double> baseline,
+                                                     const std::span<const double> contender,
+                                                     const double confidence = 0.95,
+                                                     const std::size_t resamples = 2000)
+{
+        if(baseline.empty() || contender.empty())
+        {
+                return {NAN, NAN};
+        }
+
+        std::mt19937_64 gen(0x5eed);
+        const auto resample_median = [&gen](const std::span<const double> values)
+        {
+                std::uniform_int_distribution<std::size_t> pick(0, values.size() - 1);
+                std::vector<double> sample(values.size());
+                for(auto& v : sample)
+                {
+                        v = values[pick(gen)];
+                }
+                return median(std::move(sample));
+        };
+
+        std::vector<double> changes(resamples);
+        for(auto& change : changes)
+        {
+                const auto old_median = resample_median(baseline);
+                change = resample_median(contender) / old_median - 1;
+        }
+        std::sort(changes.begin(), changes.end());
+
+        const auto tail = (1 - confidence) / 2;
+        const auto at = [&changes](const double q)
+        {
+                return changes[std::min(changes.size() - 1, std::size_t(q * double(changes.size())))];
+        };
+        return {at(tail), at(1 - tail)};
+}
+
+struct mann_whitney_result
+{
+        double u;       /* U statistic of `contender` */
+        double p_value; /* two-sided */
+};
+
+/* Mann-Whitney U test with the normal approximation (tie and continuity corrected). With fewer
+ * than ~8 samples per side the approximation is rough and p-values should be taken as hints. */
+inline mann_whitney_result mann_whitney_u(const std::span<const double> baseline,
+                                          const std::span<const double> contender)
+{
+        const auto n1 = double(baseline.size());
+        const auto n2 = double(contender.size());
+        if(baseline.empty() || contender.empty())
+        {
+                return {NAN, NAN};
+        }
+
+        struct sample
+        {
+                double value;
+                bool from_contender;
+        };
+        std::vector<sample> all;
+        all.reserve(baseline.size() + contender.size());
+        for(const auto v : baseline)
+        {
+                all.push_back({v, false});
+        }
+        for(const auto v : contender)
+        {
+                all.push_back({v, true});
+        }
+        std::sort(all.begin(), all.end(),
+                  [](const sample& lhs, const sample& rhs)
+                  {
+                          return lhs.value < rhs.value;
+                  });
+
+        /* average ranks over ties */
+        double contender_ranks = 0;
+        double tie_term = 0;
+        for(std::size_t i = 0; i < all.size();)
+        {
+                std::size_t j = i;
+                while(j < all.size() && all[j].value == all[i].value)
+                {
+                        ++j;
+                }
+
+                const auto rank = double(i + j + 1) / 2;
+                for(std::size_t k = i; k < j; ++k)
+                {
+                        contender_ranks += all[k].from_contender ? rank : 0;
+                }
+                const auto t = double(j - i);
+                tie_term += t * t * t - t;
+                i = j;
+        }
+
+        const auto u = contender_ranks - n2 * (n2 + 1) / 2;
+        const auto n = n1 + n2;
+        const auto mu = n1 * n2 / 2;
+        const auto sigma = std::sqrt(n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1))));
+        if(sigma == 0)
+        {
+                return {u, 1};
+        }
+
+        const auto z = std::max(0.0, std::abs(u - mu) - 0.5) / sigma;
+        return {u, std::erfc(z / std::sqrt(2.0))};
+}
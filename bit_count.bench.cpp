@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <bitset>
+#include <memory>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "bit_count.hpp"
+#include "dataset.hpp"
+
+static constexpr std::size_t SIZE = 1 << 24;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+static const auto global_words = uniform_dataset<std::uint64_t>(SIZE / 64, SEED);
+
+static bool bit_at(const std::size_t idx)
+{
+        return global_words[idx / 64] >> (idx % 64) & 1;
+}
+
+static const auto test_vector = []
+{
+        std::vector<bool> bits(SIZE);
+        for(std::size_t i = 0; i < SIZE; ++i)
+        {
+                bits[i] = bit_at(i);
+        }
+        return bits;
+}();
+
+static const auto test_bitmap = []
+{
+        bitmap bits(SIZE);
+        for(std::size_t i = 0; i < SIZE; ++i)
+        {
+                bits.set(i, bit_at(i));
+        }
+        return bits;
+}();
+
+/* 2 MiB, too big for the stack */
+static const auto test_bitset = []
+{
+        auto bits = std::make_unique<std::bitset<SIZE>>();
+        for(std::size_t i = 0; i < SIZE; ++i)
+        {
+                bits->set(i, bit_at(i));
+        }
+        return bits;
+}();
+
+/* Subranges start and end in the middle of a word */
+static constexpr std::size_t HEAD = 3;
+static constexpr std::size_t TAIL = 5;
+
+template<typename Count>
+static void run(benchmark::State& state, const Count& count)
+{
+        for(auto _ : state)
+        {
+                const auto tmp = count();
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE / 8));
+}
+
+/* The generic loop, like mcount_if: one bit proxy per element */
+static void vector_bool_loop(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    std::size_t count = 0;
+                    for(const bool bit : test_vector)
+                    {
+                            count += bit;
+                    }
+                    return count;
+            });
+}
+
+static void vector_bool_std_count(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    return std::count(test_vector.begin() + HEAD, test_vector.end() - TAIL, true);
+            });
+}
+
+static void vector_bool_count_true(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    return count_true(test_vector.begin() + HEAD, test_vector.end() - TAIL);
+            });
+}
+
+static void bitset_count(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    return test_bitset->count();
+            });
+}
+
+static void bitset_count_bits(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    return count_bits(*test_bitset, HEAD, SIZE - TAIL);
+            });
+}
+
+static void bitmap_count(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    return test_bitmap.count(HEAD, SIZE - TAIL);
+            });
+}
+
+/* `popcnt` on every word, without SIMD */
+static void scalar_popcount(benchmark::State& state)
+{
+        run(state,
+            []
+            {
+                    return popcount_words_scalar(test_bitmap.data(), SIZE / 64);
+            });
+}
+
+BENCHMARK(vector_bool_loop);
+BENCHMARK(vector_bool_std_count);
+BENCHMARK(vector_bool_count_true);
+BENCHMARK(bitset_count);
+BENCHMARK(bitset_count_bits);
+BENCHMARK(bitmap_count);
+BENCHMARK(scalar_popcount);
+
+BENCHMARK_MAIN();
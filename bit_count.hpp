@@ -0,0 +1,195 @@
+#pragma once
+
+/* Counting set bits in bit-packed containers a word at a time. `std::count` over a
+ * std::vector<bool> goes through one bit proxy per element, and nothing vectorizes. Here the
+ * words are counted with `vpopcntq` (AVX-512 VPOPCNTDQ), with Mula's nibble lookup (a `vpshufb`
+ * per nibble, summed with `vpsadbw`) on AVX2, or with `popcnt`; only the partial words at the ends
+ * of a range are masked. */
+
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX512VPOPCNTDQ__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+inline std::size_t popcount_words_scalar(const std::uint64_t* words, const std::size_t n)
+{
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < n; ++i)
+        {
+                count += std::size_t(std::popcount(words[i]));
+        }
+        return count;
+}
+
+/* Set bits in words[0, n) */
+inline std::size_t popcount_words(const std::uint64_t* words, const std::size_t n)
+{
+        std::size_t i = 0;
+        std::size_t count = 0;
+
+#if defined(__AVX512VPOPCNTDQ__)
+        auto acc = _mm512_setzero_si512();
+        for(; i + 8 <= n; i += 8)
+        {
+                acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+        }
+        alignas(64) std::uint64_t lanes[8];
+        _mm512_store_si512(lanes, acc);
+        for(const auto lane : lanes)
+        {
+                count += lane;
+        }
+#elif defined(__AVX2__)
+        /* the bit count of each nibble, in both 128-bit lanes */
+        // clang-format off
+        const auto lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        // clang-format on
+        const auto nibble = _mm256_set1_epi8(0x0f);
+        const auto zero = _mm256_setzero_si256();
+        auto acc = _mm256_setzero_si256();
+        for(; i + 4 <= n; i += 4)
+        {
+                const auto v = _mm256_loadu_si256((const __m256i*)(words + i));
+                const auto lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble));
+                const auto hi = _mm256_shuffle_epi8(
+                    lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+                acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), zero));
+        }
+        alignas(32) std::uint64_t lanes[4];
+        _mm256_store_si256((__m256i*)lanes, acc);
+        count = std::size_t(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+
+        return count + popcount_words_scalar(words + i, n - i);
+}
+
+/* Set bits among bits [first_bit, last_bit) of `words`, bit i being bit i % 64 of word i / 64 */
+inline std::size_t count_bits(const std::uint64_t* words, const std::size_t first_bit,
+                              const std::size_t last_bit)
+{
+        if(first_bit >= last_bit)
+        {
+                return 0;
+        }
+
+        const auto first_word = first_bit / 64;
+        const auto last_word = last_bit / 64;
+        const auto head = first_bit % 64;
+        const auto tail = last_bit % 64;
+        if(first_word == last_word)
+        {
+                const auto mask = ((std::uint64_t(1) << (tail - head)) - 1) << head;
+                return std::size_t(std::popcount(words[first_word] & mask));
+        }
+
+        /* the last word is only read if some of its bits are in the range */
+        auto count = std::size_t(std::popcount(words[first_word] >> head));
+        count += popcount_words(words + first_word + 1, last_word - first_word - 1);
+        if(tail != 0)
+        {
+                count += std::size_t(
+                    std::popcount(words[last_word] & ((std::uint64_t(1) << tail) - 1)));
+        }
+        return count;
+}
+
+/* A fixed-size sequence of bits in 64-bit words, with counts over any subrange */
+class bitmap
+{
+public:
+        explicit bitmap(const std::size_t size = 0)
+            : words_((size + 63) / 64),
+              size_(size)
+        {
+        }
+
+        std::size_t size() const
+        {
+                return size_;
+        }
+
+        bool test(const std::size_t idx) const
+        {
+                return words_[idx / 64] >> (idx % 64) & 1;
+        }
+
+        void set(const std::size_t idx, const bool value = true)
+        {
+                const auto bit = std::uint64_t(1) << (idx % 64);
+                words_[idx / 64] = value ? words_[idx / 64] | bit : words_[idx / 64] & ~bit;
+        }
+
+        void reset(const std::size_t idx)
+        {
+                set(idx, false);
+        }
+
+        const std::uint64_t* data() const
+        {
+                return words_.data();
+        }
+
+        std::size_t count(const std::size_t first, const std::size_t last) const
+        {
+                return count_bits(words_.data(), first, last);
+        }
+
+        std::size_t count() const
+        {
+                return count(0, size_);
+        }
+
+private:
+        std::vector<std::uint64_t> words_;
+        std::size_t size_;
+};
+
+/* Bits [first, last) of a std::bitset. libstdc++ stores them in an array of unsigned long (the
+ * only member of its base), in the same order as count_bits. */
+template<std::size_t N>
+std::size_t count_bits(const std::bitset<N>& bits, const std::size_t first = 0,
+                       const std::size_t last = N)
+{
+#if defined(__GLIBCXX__)
+        if constexpr(N > 0)
+        {
+                static_assert(sizeof(bits) == (N + 63) / 64 * sizeof(std::uint64_t));
+                return count_bits(reinterpret_cast<const std::uint64_t*>(&bits), first,
+                                  std::min(last, N));
+        }
+#endif
+        std::size_t count = 0;
+        for(std::size_t i = first; i < std::min(last, N); ++i)
+        {
+                count += bits.test(i);
+        }
+        return count;
+}
+
+/* std::count(first, last, true), a word at a time for std::vector<bool> iterators (libstdc++'s
+ * _Bit_iterator: `_M_p` is the word, `_M_offset` the bit in it) */
+template<std::forward_iterator It>
+std::size_t count_true(const It first, const It last)
+{
+#if defined(__GLIBCXX__)
+        if constexpr(std::is_base_of_v<std::_Bit_iterator_base, It>)
+        {
+                static_assert(std::is_same_v<std::_Bit_type, std::uint64_t>);
+                const auto n = std::size_t(last - first);
+                return count_bits(first._M_p, first._M_offset, first._M_offset + n);
+        }
+        else
+#endif
+        {
+                return std::size_t(std::count(first, last, true));
+        }
+}
@@ -1,61 +1,42 @@
 #include <benchmark/benchmark.h>
-#include <random>
-#include <ctime>
+#include <algorithm>
+#include <span>
 #include <vector>
 
-const std::size_t SIZE = 1 << 20;
-
-const auto test_vec = []()
-{
-        std::vector<int> vec;
-        vec.reserve(SIZE);
-
-        std::srand(std::time(0));
-        for(std::size_t i = 0; i < SIZE; ++i)
-        {
-                vec.push_back(std::rand());
-        }
-
-        return vec;
-}();
-
-template<typename _Predicate>
-struct _Iter_pred_auto
-{
-        _Predicate _M_pred;
-
-        _GLIBCXX20_CONSTEXPR
-        explicit _Iter_pred_auto(_Predicate __pred)
-            : _M_pred(_GLIBCXX_MOVE(__pred))
-        {
-        }
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "iter_pred.hpp"
 
-        // RETURNS THE ORIGINAL TYPE OF THE LAMBDA
-        template<typename _Iterator>
-        _GLIBCXX20_CONSTEXPR auto operator()(_Iterator __it) const
-        {
-                return _M_pred(*__it);
-        }
+const std::size_t SIZE = 1 << 20;
+const std::uint64_t SEED = 0x5eed;
+
+/* Branchy scalar code is sensitive to how predictable the predicate outcome is, the vectorized
+ * versions are not */
+const distribution_params DISTRIBUTIONS[] = {
+    {distribution::uniform},
+    {distribution::all_even},
+    {distribution::all_odd},
+    {distribution::alternating},
+    {distribution::long_runs, 0.5, 16},
+    {distribution::long_runs, 0.5, 4096},
+    {distribution::sorted},
+    {distribution::match_probability, 0.01},
+    {distribution::match_probability, 0.1},
+    {distribution::match_probability, 0.25},
+    {distribution::match_probability, 0.75},
+    {distribution::match_probability, 0.9},
+    {distribution::match_probability, 0.99},
 };
 
-template<typename _Predicate>
-struct _Iter_pred_bool
+const auto test_vecs = []()
 {
-        _Predicate _M_pred;
-
-        _GLIBCXX20_CONSTEXPR
-        explicit _Iter_pred_bool(_Predicate __pred)
-            : _M_pred(_GLIBCXX_MOVE(__pred))
-        {
-        }
-
-        // IGNORES THE ORIGINAL TYPE RETURNED BY THE LAMBDA
-        template<typename _Iterator>
-        _GLIBCXX20_CONSTEXPR bool operator()(_Iterator __it) const
+        std::vector<dataset<int>> vecs;
+        for(const auto& params : DISTRIBUTIONS)
         {
-                return bool(_M_pred(*__it));
+                vecs.push_back(distribution_dataset<int>(SIZE, SEED, params));
         }
-};
+        return vecs;
+}();
 
 const auto is_even_int = [](const int el) -> int
 {
@@ -76,23 +57,26 @@ auto mcount_if(It first, const It last, const auto pred)
         return result;
 }
 
-auto version1(const std::vector<int>& vec)
+auto version1(const std::span<const int> vec)
 {
         return mcount_if(vec.begin(), vec.end(), _Iter_pred_bool{is_even_int});
 }
 
-auto version2(const std::vector<int>& vec)
+auto version2(const std::span<const int> vec)
 {
         return mcount_if(vec.begin(), vec.end(), _Iter_pred_auto{is_even_int});
 }
 
-auto version3(const std::vector<int>& vec)
+auto version3(const std::span<const int> vec)
 {
         return std::count_if(vec.begin(), vec.end(), is_even_int);
 }
 
 static void v_return_bool(benchmark::State& state)
 {
+        const auto& test_vec = test_vecs[std::size_t(state.range(0))];
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(0)]));
+
         for(auto _ : state)
         {
                 const auto tmp = version1(test_vec);
@@ -102,6 +86,9 @@ static void v_return_bool(benchmark::State& state)
 
 static void v_return_auto(benchmark::State& state)
 {
+        const auto& test_vec = test_vecs[std::size_t(state.range(0))];
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(0)]));
+
         for(auto _ : state)
         {
                 const auto tmp = version2(test_vec);
@@ -111,6 +98,9 @@ static void v_return_auto(benchmark::State& state)
 
 static void std_count_if(benchmark::State& state)
 {
+        const auto& test_vec = test_vecs[std::size_t(state.range(0))];
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(0)]));
+
         for(auto _ : state)
         {
                 const auto tmp = version3(test_vec);
@@ -118,8 +108,10 @@ static void std_count_if(benchmark::State& state)
         }
 }
 
-BENCHMARK(v_return_bool)->Unit(benchmark::kMicrosecond);
-BENCHMARK(v_return_auto)->Unit(benchmark::kMicrosecond);
-BENCHMARK(std_count_if)->Unit(benchmark::kMicrosecond);
+static constexpr int NUM_DISTRIBUTIONS = int(std::size(DISTRIBUTIONS));
+
+BENCHMARK(v_return_bool)->DenseRange(0, NUM_DISTRIBUTIONS - 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(v_return_auto)->DenseRange(0, NUM_DISTRIBUTIONS - 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(std_count_if)->DenseRange(0, NUM_DISTRIBUTIONS - 1)->Unit(benchmark::kMicrosecond);
 
 BENCHMARK_MAIN();
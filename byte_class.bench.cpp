@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+
+#include "bench_context.hpp"
+#include "byte_class.hpp"
+#include "dataset.hpp"
+
+static constexpr std::size_t SIZE = 1 << 24;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+static const auto global_vec = uniform_dataset<std::uint8_t>(SIZE, SEED);
+
+struct named_class
+{
+        const char* name;
+        byte_class cls;
+};
+
+/* The classes are data-independent for both kernels, so uniform bytes are enough; the last one
+ * has more than 8 distinct nibble rows and needs both table pairs */
+static const named_class CLASSES[] = {
+    {"even",
+     byte_class(
+         [](const std::uint8_t b)
+         {
+                 return b % 2 == 0;
+         })},
+    {"digits", byte_class_of("0123456789")},
+    {"whitespace", byte_class_of(" \t\n\v\f\r")},
+    {"delimiters", byte_class_of(",;:|\t\"'")},
+    {"invalid_utf8",
+     byte_class(
+         [](const std::uint8_t b)
+         {
+                 return b == 0xc0 || b == 0xc1 || b >= 0xf5;
+         })},
+    {"scattered",
+     byte_class(
+         [](const std::uint8_t b)
+         {
+                 return counter_hash(SEED, b) % 3 == 0;
+         })},
+};
+
+template<typename Count>
+static void run(benchmark::State& state, const Count& count)
+{
+        const auto& named = CLASSES[state.range(0)];
+
+        for(auto _ : state)
+        {
+                const auto tmp = count(global_vec.data(), global_vec.size(), named.cls);
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE));
+        state.SetLabel(std::string(named.name) + " pairs:" + std::to_string(named.cls.pairs));
+}
+
+static void scalar_table(benchmark::State& state)
+{
+        run(state, count_byte_class_scalar);
+}
+
+static void nibble_lookup(benchmark::State& state)
+{
+        run(state, count_byte_class);
+}
+
+static constexpr int NUM_CLASSES = int(std::size(CLASSES));
+
+BENCHMARK(scalar_table)->DenseRange(0, NUM_CLASSES - 1);
+BENCHMARK(nibble_lookup)->DenseRange(0, NUM_CLASSES - 1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,216 @@
+#pragma once
+
+/* Counting bytes that belong to an arbitrary set of the 256 values (digits, whitespace,
+ * delimiters, ...). The set is split on the two nibbles of a byte: bytes whose high nibble selects
+ * the same set of low nibbles form a group, and a byte is a member if its low nibble's groups and
+ * its high nibble's group share a bit. With up to 8 groups that is one `vpshufb` table per
+ * nibble, and two pairs of tables otherwise, so 16 or 32 bytes of tables classify a whole vector.
+ * Members are added to 8-bit counters like `count_even<true, uint8_t>` in aligned_unreachable.md
+ * does, but the counters are summed with `vpsadbw` every 255 steps, before they can wrap. */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+struct byte_class
+{
+        /* a scalar lookup table, and the nibble tables: low[p][lo] & high[p][hi] != 0 for a
+         * member in one of the `pairs` table pairs */
+        std::array<bool, 256> members{};
+        alignas(16) std::uint8_t low[2][16]{};
+        alignas(16) std::uint8_t high[2][16]{};
+        unsigned pairs = 1;
+
+        template<typename Pred>
+        constexpr explicit byte_class(const Pred pred)
+        {
+                for(unsigned b = 0; b < 256; ++b)
+                {
+                        members[b] = pred(std::uint8_t(b));
+                }
+
+                /* the distinct non-empty rows: for a high nibble, the low nibbles of its members */
+                std::uint16_t rows[16]{};
+                unsigned groups = 0;
+                for(unsigned hi = 0; hi < 16; ++hi)
+                {
+                        std::uint16_t row = 0;
+                        for(unsigned lo = 0; lo < 16; ++lo)
+                        {
+                                row = std::uint16_t(row | members[hi * 16 + lo] << lo);
+                        }
+                        if(row == 0)
+                        {
+                                continue;
+                        }
+
+                        unsigned group = 0;
+                        while(group < groups && rows[group] != row)
+                        {
+                                ++group;
+                        }
+                        if(group == groups)
+                        {
+                                rows[groups++] = row;
+                        }
+
+                        high[group / 8][hi] = std::uint8_t(1u << group % 8);
+                        for(unsigned lo = 0; lo < 16; ++lo)
+                        {
+                                if(row >> lo & 1)
+                                {
+                                        low[group / 8][lo] |= std::uint8_t(1u << group % 8);
+                                }
+                        }
+                }
+                pairs = groups > 8 ? 2 : 1;
+        }
+
+        constexpr bool contains(const std::uint8_t b) const
+        {
+                return members[b];
+        }
+};
+
+/* The bytes that appear in `chars` */
+constexpr byte_class byte_class_of(const std::string_view chars)
+{
+        return byte_class(
+            [chars](const std::uint8_t b)
+            {
+                    return chars.find(char(b)) != std::string_view::npos;
+            });
+}
+
+/* Plain loop over the 256-entry table */
+inline std::uint64_t count_byte_class_scalar(const std::uint8_t* data, const std::size_t size,
+                                             const byte_class& cls)
+{
+        std::uint64_t count = 0;
+        for(std::size_t i = 0; i < size; ++i)
+        {
+                count += cls.members[data[i]];
+        }
+        return count;
+}
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+template<unsigned PAIRS>
+std::uint64_t count_byte_class_simd(const std::uint8_t* data, const std::size_t size,
+                                    const byte_class& cls)
+{
+#if defined(__AVX512BW__)
+        using vec = __m512i;
+        constexpr std::size_t STEP = 64;
+        const auto table = [](const std::uint8_t* t)
+        {
+                return _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128((const __m128i*)t));
+        };
+        const vec lo_t[2] = {table(cls.low[0]), table(cls.low[1])};
+        const vec hi_t[2] = {table(cls.high[0]), table(cls.high[1])};
+        const auto zero = _mm512_setzero_si512();
+        const auto one = _mm512_set1_epi8(1);
+        const auto nibble = _mm512_set1_epi8(0x0f);
+        /* 1 for a member, 0 otherwise */
+        const auto classify = [&](const std::uint8_t* ptr)
+        {
+                const auto v = _mm512_loadu_si512(ptr);
+                const auto lo = _mm512_and_si512(v, nibble);
+                const auto hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble);
+                auto hits = _mm512_and_si512(_mm512_shuffle_epi8(lo_t[0], lo),
+                                             _mm512_shuffle_epi8(hi_t[0], hi));
+                if constexpr(PAIRS == 2)
+                {
+                        hits = _mm512_or_si512(hits,
+                                               _mm512_and_si512(_mm512_shuffle_epi8(lo_t[1], lo),
+                                                                _mm512_shuffle_epi8(hi_t[1], hi)));
+                }
+                return _mm512_min_epu8(hits, one);
+        };
+        const auto add = [](const vec a, const vec b)
+        {
+                return _mm512_add_epi8(a, b);
+        };
+        const auto byte_sum = [&](const vec acc)
+        {
+                alignas(64) std::uint64_t lanes[8];
+                _mm512_store_si512(lanes, _mm512_sad_epu8(acc, zero));
+                std::uint64_t sum = 0;
+                for(const auto lane : lanes)
+                {
+                        sum += lane;
+                }
+                return sum;
+        };
+#else
+        using vec = __m256i;
+        constexpr std::size_t STEP = 32;
+        const auto table = [](const std::uint8_t* t)
+        {
+                return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t));
+        };
+        const vec lo_t[2] = {table(cls.low[0]), table(cls.low[1])};
+        const vec hi_t[2] = {table(cls.high[0]), table(cls.high[1])};
+        const auto zero = _mm256_setzero_si256();
+        const auto one = _mm256_set1_epi8(1);
+        const auto nibble = _mm256_set1_epi8(0x0f);
+        const auto classify = [&](const std::uint8_t* ptr)
+        {
+                const auto v = _mm256_loadu_si256((const __m256i*)ptr);
+                const auto lo = _mm256_and_si256(v, nibble);
+                const auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+                auto hits = _mm256_and_si256(_mm256_shuffle_epi8(lo_t[0], lo),
+                                             _mm256_shuffle_epi8(hi_t[0], hi));
+                if constexpr(PAIRS == 2)
+                {
+                        hits = _mm256_or_si256(hits,
+                                               _mm256_and_si256(_mm256_shuffle_epi8(lo_t[1], lo),
+                                                                _mm256_shuffle_epi8(hi_t[1], hi)));
+                }
+                return _mm256_min_epu8(hits, one);
+        };
+        const auto add = [](const vec a, const vec b)
+        {
+                return _mm256_add_epi8(a, b);
+        };
+        const auto byte_sum = [&](const vec acc)
+        {
+                alignas(32) std::uint64_t lanes[4];
+                _mm256_store_si256((__m256i*)lanes, _mm256_sad_epu8(acc, zero));
+                return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        };
+#endif
+
+        std::uint64_t count = 0;
+        std::size_t i = 0;
+        while(size - i >= STEP)
+        {
+                const auto steps = std::min<std::size_t>(255, (size - i) / STEP);
+                auto acc = zero;
+                for(std::size_t s = 0; s < steps; ++s, i += STEP)
+                {
+                        acc = add(acc, classify(data + i));
+                }
+                count += byte_sum(acc);
+        }
+        return count + count_byte_class_scalar(data + i, size - i, cls);
+}
+#endif
+
+/* Number of bytes in `data` that are members of `cls` */
+inline std::uint64_t count_byte_class(const std::uint8_t* data, const std::size_t size,
+                                      const byte_class& cls)
+{
+#if defined(__AVX512BW__) || defined(__AVX2__)
+        return cls.pairs == 1 ? count_byte_class_simd<1>(data, size, cls)
+                              : count_byte_class_simd<2>(data, size, cls);
+#else
+        return count_byte_class_scalar(data, size, cls);
+#endif
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+/* Which fields of a hot struct (or elements of an array) can end up on the same cache line, at
+ * compile time and as a printed report. Fields are registered by hand:
+ *
+ *     static constexpr field_info counters_fields[] = {
+ *         CACHE_LAYOUT_FIELD(counters, hits, 0),
+ *         CACHE_LAYOUT_FIELD(counters, misses, 1),
+ *     };
+ *     ASSERT_NO_FALSE_SHARING(counters_fields, alignof(counters));
+ *
+ * The last argument tags the thread that writes the field; READ_MOSTLY fields are not checked.
+ * Since the address of the object is only known up to its alignment, a pair of fields counts as
+ * sharing a line if it does for any placement the alignment allows. */
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <span>
+
+#include "cache_padded.hpp"
+
+inline constexpr int READ_MOSTLY = -1;
+
+struct field_info
+{
+        const char* name;
+        std::size_t offset;
+        std::size_t size;
+        int writer;     /* thread tag, or READ_MOSTLY */
+        int index = -1; /* element index for arrays */
+};
+
+#define CACHE_LAYOUT_FIELD(type, member, writer)                                                   \
+        field_info{#member, offsetof(type, member), sizeof(type::member), writer}
+
+/* One entry per element of a `T[N]`, element i written by thread i */
+template<typename T, std::size_t N>
+constexpr std::array<field_info, N> array_fields(const char* name)
+{
+        std::array<field_info, N> fields{};
+        for(std::size_t i = 0; i < N; ++i)
+        {
+                fields[i] = {name, i * sizeof(T), sizeof(T), int(i), int(i)};
+        }
+        return fields;
+}
+
+/* Whether `a` and `b` touch a common `line`-byte line when the object starts at some address
+ * aligned to `align` */
+constexpr bool may_share_line(const field_info& a, const field_info& b, const std::size_t line,
+                              const std::size_t align)
+{
+        for(std::size_t base = 0; base < line; base += align)
+        {
+                const auto a_first = (base + a.offset) / line;
+                const auto a_last = (base + a.offset + a.size - 1) / line;
+                const auto b_first = (base + b.offset) / line;
+                const auto b_last = (base + b.offset + b.size - 1) / line;
+                if(a_first <= b_last && b_first <= a_last)
+                {
+                        return true;
+                }
+        }
+        return false;
+}
+
+constexpr bool conflicting(const field_info& a, const field_info& b, const std::size_t line,
+                           const std::size_t align)
+{
+        return a.writer != READ_MOSTLY && b.writer != READ_MOSTLY && a.writer != b.writer &&
+               may_share_line(a, b, line, align);
+}
+
+/* No two fields written by different threads can share a `line`-byte line */
+constexpr bool writers_separated(const std::span<const field_info> fields,
+                                 const std::size_t line, const std::size_t align)
+{
+        for(std::size_t i = 0; i < fields.size(); ++i)
+        {
+                for(std::size_t j = i + 1; j < fields.size(); ++j)
+                {
+                        if(conflicting(fields[i], fields[j], line, align))
+                        {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+
+/* Checked against destructive_interference_size, i.e. the 128-byte prefetch pairs on x86-64 */
+#define ASSERT_NO_FALSE_SHARING(fields, align)                                                     \
+        static_assert(writers_separated(fields, destructive_interference_size, align),            \
+                      "fields written by different threads share a cache line: " #fields)
+
+/* Offsets, sizes and writers of `fields`, then the conflicting pairs for 64- and 128-byte
+ * lines */
+inline void print_cache_layout(std::ostream& out, const char* title,
+                               const std::span<const field_info> fields, const std::size_t align)
+{
+        const auto print_name = [&out](const field_info& field)
+        {
+                out << field.name;
+                if(field.index >= 0)
+                {
+                        out << '[' << field.index << ']';
+                }
+        };
+
+        out << title << " (alignment " << align << "):\n";
+        for(const auto& field : fields)
+        {
+                out << "  ";
+                print_name(field);
+                out << ": offset " << field.offset << ", size " << field.size << ", writer ";
+                if(field.writer == READ_MOSTLY)
+                {
+                        out << "none\n";
+                }
+                else
+                {
+                        out << field.writer << '\n';
+                }
+        }
+
+        for(const std::size_t line : {std::size_t(64), std::size_t(128)})
+        {
+                out << "  " << line << "-byte lines:";
+                bool any = false;
+                for(std::size_t i = 0; i < fields.size(); ++i)
+                {
+                        for(std::size_t j = i + 1; j < fields.size(); ++j)
+                        {
+                                if(conflicting(fields[i], fields[j], line, align))
+                                {
+                                        out << (any ? ", " : " ");
+                                        print_name(fields[i]);
+                                        out << " & ";
+                                        print_name(fields[j]);
+                                        any = true;
+                                }
+                        }
+                }
+                out << (any ? "\n" : " no false sharing\n");
+        }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+/* Types that keep data written by different threads on different cache lines. */
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* Smallest distance at which two objects written by different threads don't interfere. On x86-64
+ * that is two cache lines, since the L2 spatial prefetcher fetches lines in 128-byte pairs. */
+#if defined(__x86_64__) || defined(__i386__)
+inline constexpr std::size_t destructive_interference_size = 128;
+#elif defined(__cpp_lib_hardware_interference_size)
+inline constexpr std::size_t destructive_interference_size =
+    std::hardware_destructive_interference_size;
+#else
+inline constexpr std::size_t destructive_interference_size = 64;
+#endif
+
+/* `T` alone on its `ALIGN`-byte block: aligned to it and padded to a multiple of it */
+template<typename T, std::size_t ALIGN = destructive_interference_size>
+struct alignas(ALIGN) cache_padded
+{
+        T value{};
+
+        cache_padded() = default;
+
+        template<typename... Args>
+        explicit cache_padded(std::in_place_t, Args&&... args)
+            : value(std::forward<Args>(args)...)
+        {
+        }
+
+        T& operator*()
+        {
+                return value;
+        }
+
+        const T& operator*() const
+        {
+                return value;
+        }
+
+        T* operator->()
+        {
+                return &value;
+        }
+
+        const T* operator->() const
+        {
+                return &value;
+        }
+};
+
+template<typename T>
+struct is_std_atomic : std::false_type
+{
+};
+
+template<typename T>
+struct is_std_atomic<std::atomic<T>> : std::true_type
+{
+};
+
+/* A runtime-sized array of padded slots, one per thread (or per CPU, shard, ...) */
+template<typename T, std::size_t ALIGN = destructive_interference_size>
+class per_thread
+{
+public:
+        explicit per_thread(const std::size_t size)
+            : slots_(std::make_unique<cache_padded<T, ALIGN>[]>(size))
+            , size_(size)
+        {
+        }
+
+        T& operator[](const std::size_t idx)
+        {
+                return slots_[idx].value;
+        }
+
+        const T& operator[](const std::size_t idx) const
+        {
+                return slots_[idx].value;
+        }
+
+        std::size_t size() const
+        {
+                return size_;
+        }
+
+        /* Left fold of `op` over the slots, starting with `init`. Atomic slots are read with
+         * relaxed loads: concurrent writers make the result a snapshot, not an exact value. */
+        template<typename U, typename BinaryOp>
+        U combine(U init, BinaryOp op) const
+        {
+                for(std::size_t i = 0; i < size_; ++i)
+                {
+                        init = op(std::move(init), load(slots_[i].value));
+                }
+                return init;
+        }
+
+        /* Sum of the slots */
+        auto combine() const
+        {
+                using value_type = std::remove_cvref_t<decltype(load(std::declval<const T&>()))>;
+                return combine(value_type{}, std::plus<>{});
+        }
+
+private:
+        std::unique_ptr<cache_padded<T, ALIGN>[]> slots_;
+        std::size_t size_;
+
+        static decltype(auto) load(const T& value)
+        {
+                if constexpr(is_std_atomic<T>::value)
+                {
+                        return value.load(std::memory_order_relaxed);
+                }
+                else
+                {
+                        return (value);
+                }
+        }
+};
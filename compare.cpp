@@ -0,0 +1,445 @@
+/* Statistical comparison of google-benchmark results, a replacement for `compare.py`.
+ *
+ * usage: compare [options] benchmarks <baseline> <contender> [--benchmark_...]
+ *        compare [options] filters <binary> <filter_baseline> <filter_contender> [--benchmark_...]
+ *
+ * <baseline>, <contender> and <binary> are benchmark binaries or their JSON output. Binaries are
+ * run with `--benchmark_repetitions` and any `--benchmark_*` flag given on the command line.
+ * The filters are POSIX extended regular expressions: as in compare.py, each side keeps the runs
+ * whose names its filter matches, with every match replaced by
+ * `[<filter_baseline> vs. <filter_contender>]` so that the two sides line up. They are compiled
+ * with regcomp(), which reports an invalid pattern without an exception (the tools are built
+ * with -fno-exceptions, where std::regex aborts instead).
+ *
+ * options:
+ *   --repetitions=N  repetitions per benchmark when running binaries (default: 10)
+ *   --alpha=X        significance level of the Mann-Whitney U test (default: 0.05)
+ *   --noise=X        flag runs whose coefficient of variation exceeds X (default: 0.05)
+ *   --markdown=FILE  write the markdown table to FILE instead of stdout
+ *
+ * For every benchmark present on both sides it prints the relative change of the median real
+ * and CPU times (negative is faster, like compare.py), the old and new medians, a 95% bootstrap
+ * confidence interval of the real time change and the U test p-value. The markdown table keeps
+ * compare.py's columns first, so it can be pasted next to the existing outputs in the .md
+ * files. Exits with 1 on usage or input errors, 0 otherwise. */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <regex.h>
+#include <unistd.h>
+
+#include "bench_report.hpp"
+#include "bench_stats.hpp"
+
+struct options
+{
+        std::size_t repetitions = 10;
+        double alpha = 0.05;
+        double noise = 0.05;
+        std::string markdown_path;
+        std::vector<std::string> benchmark_args;
+        std::vector<std::string> positional;
+};
+
+struct comparison
+{
+        std::string name;
+        std::string time_unit;
+        double time_old, time_new;
+        double cpu_old, cpu_new;
+        confidence_interval time_ci;
+        double p_value;
+        std::size_t reps_old, reps_new;
+        bool noisy;
+};
+
+enum class verdict
+{
+        same,
+        faster,
+        slower,
+};
+
+static verdict classify(const comparison& cmp, const double alpha)
+{
+        /* significant only if the rank test agrees and the bootstrap interval excludes 0 */
+        if(!(cmp.p_value < alpha))
+        {
+                return verdict::same;
+        }
+        if(cmp.time_ci.upper < 0)
+        {
+                return verdict::faster;
+        }
+        if(cmp.time_ci.lower > 0)
+        {
+                return verdict::slower;
+        }
+        return verdict::same;
+}
+
+static std::string note(const comparison& cmp, const double alpha)
+{
+        std::string out;
+        switch(classify(cmp, alpha))
+        {
+        case verdict::faster:
+                out = "faster";
+                break;
+        case verdict::slower:
+                out = "SLOWER";
+                break;
+        case verdict::same:
+                out = "~";
+                break;
+        }
+        if(cmp.noisy)
+        {
+                out += " (noisy)";
+        }
+        return out;
+}
+
+static comparison compare_runs(std::string name, const benchmark_run& old_run,
+                               const benchmark_run& new_run, const double noise)
+{
+        comparison cmp;
+        cmp.name = std::move(name);
+        cmp.time_unit = old_run.time_unit;
+        cmp.time_old = median(old_run.real_time);
+        cmp.time_new = median(new_run.real_time);
+        cmp.cpu_old = median(old_run.cpu_time);
+        cmp.cpu_new = median(new_run.cpu_time);
+        cmp.time_ci = bootstrap_relative_change(old_run.real_time, new_run.real_time);
+        cmp.p_value = mann_whitney_u(old_run.real_time, new_run.real_time).p_value;
+        cmp.reps_old = old_run.real_time.size();
+        cmp.reps_new = new_run.real_time.size();
+        cmp.noisy = coefficient_of_variation(old_run.real_time) > noise ||
+                    coefficient_of_variation(new_run.real_time) > noise;
+        return cmp;
+}
+
+static std::string format_row(const comparison& cmp, const int name_width, const double alpha)
+{
+        char ci[64];
+        std::snprintf(ci, sizeof(ci), "[%+.4f, %+.4f]", cmp.time_ci.lower, cmp.time_ci.upper);
+
+        char buf[512];
+        std::snprintf(buf, sizeof(buf), "%-*s%+16.4f%+16.4f%14.0f%14.0f%14.0f%14.0f%24s%10.4f  %s",
+                      name_width, cmp.name.c_str(), cmp.time_new / cmp.time_old - 1,
+                      cmp.cpu_new / cmp.cpu_old - 1, cmp.time_old, cmp.time_new, cmp.cpu_old,
+                      cmp.cpu_new, ci, cmp.p_value, note(cmp, alpha).c_str());
+        return buf;
+}
+
+static std::string format_header(const int name_width)
+{
+        char buf[512];
+        std::snprintf(buf, sizeof(buf), "%-*s%16s%16s%14s%14s%14s%14s%24s%10s  %s", name_width,
+                      "Benchmark", "Time", "CPU", "Time Old", "Time New", "CPU Old", "CPU New",
+                      "Time 95% CI", "p-value", "Note");
+        return buf;
+}
+
+static void print_terminal(const std::vector<comparison>& cmps, const int name_width,
+                           const double alpha)
+{
+        const bool color = ::isatty(STDOUT_FILENO);
+        const auto header = format_header(name_width);
+        std::printf("%s\n%s\n", header.c_str(), std::string(header.size(), '-').c_str());
+
+        for(const auto& cmp : cmps)
+        {
+                const char* begin = "";
+                if(color)
+                {
+                        switch(classify(cmp, alpha))
+                        {
+                        case verdict::faster:
+                                begin = "\033[32m";
+                                break;
+                        case verdict::slower:
+                                begin = "\033[31m";
+                                break;
+                        case verdict::same:
+                                begin = cmp.noisy ? "\033[33m" : "";
+                                break;
+                        }
+                }
+                std::printf("%s%s%s\n", begin, format_row(cmp, name_width, alpha).c_str(),
+                            *begin != '\0' ? "\033[0m" : "");
+        }
+}
+
+static void print_markdown(std::FILE* out, const std::vector<comparison>& cmps,
+                           const int name_width, const options& opts)
+{
+        const auto header = format_header(name_width);
+        std::fprintf(out, "```\n%s\n%s\n", header.c_str(), std::string(header.size(), '-').c_str());
+        for(const auto& cmp : cmps)
+        {
+                std::fprintf(out, "%s\n", format_row(cmp, name_width, opts.alpha).c_str());
+        }
+        std::fprintf(out, "```\n");
+
+        if(!cmps.empty())
+        {
+                std::fprintf(out,
+                             "Medians of %zu vs. %zu repetitions; 95%% bootstrap CI of the real time "
+                             "change; two-sided Mann-Whitney U test, alpha = %g; noisy: coefficient "
+                             "of variation > %g.\n",
+                             cmps.front().reps_old, cmps.front().reps_new, opts.alpha, opts.noise);
+        }
+}
+
+static bool parse_options(const int argc, char** argv, options& opts)
+{
+        for(int i = 1; i < argc; ++i)
+        {
+                const std::string_view arg = argv[i];
+                const auto value = [&arg]()
+                {
+                        return std::string(arg.substr(arg.find('=') + 1));
+                };
+
+                if(arg.starts_with("--repetitions="))
+                {
+                        opts.repetitions = std::strtoul(value().c_str(), nullptr, 10);
+                }
+                else if(arg.starts_with("--alpha="))
+                {
+                        opts.alpha = std::strtod(value().c_str(), nullptr);
+                }
+                else if(arg.starts_with("--noise="))
+                {
+                        opts.noise = std::strtod(value().c_str(), nullptr);
+                }
+                else if(arg.starts_with("--markdown="))
+                {
+                        opts.markdown_path = value();
+                }
+                else if(arg.starts_with("--benchmark_"))
+                {
+                        opts.benchmark_args.emplace_back(arg);
+                }
+                else if(arg.starts_with("--"))
+                {
+                        return false;
+                }
+                else
+                {
+                        opts.positional.emplace_back(arg);
+                }
+        }
+
+        if(opts.positional.empty() || opts.repetitions == 0)
+        {
+                return false;
+        }
+        const auto& mode = opts.positional.front();
+        return (mode == "benchmarks" && opts.positional.size() == 3) ||
+               (mode == "filters" && opts.positional.size() == 4);
+}
+
+static std::optional<benchmark_report> load(const std::string& source, const options& opts,
+                                            const std::string& filter)
+{
+        auto args = opts.benchmark_args;
+        args.push_back("--benchmark_repetitions=" + std::to_string(opts.repetitions));
+        if(!filter.empty())
+        {
+                args.push_back("--benchmark_filter=" + filter);
+        }
+
+        auto report = load_benchmark_report(source, args);
+        if(!report)
+        {
+                std::fprintf(stderr, "compare: could not get benchmark results from '%s'\n",
+                             source.c_str());
+        }
+        return report;
+}
+
+/* A compiled filter; `error` is regcomp()'s message if the pattern is invalid */
+class filter_regex
+{
+public:
+        explicit filter_regex(const std::string& pattern)
+        {
+                const int err = ::regcomp(&re_, pattern.c_str(), REG_EXTENDED);
+                if(err != 0)
+                {
+                        char buf[256];
+                        ::regerror(err, &re_, buf, sizeof(buf));
+                        error = buf;
+                        return;
+                }
+                compiled_ = true;
+        }
+
+        filter_regex(const filter_regex&) = delete;
+        filter_regex& operator=(const filter_regex&) = delete;
+
+        ~filter_regex()
+        {
+                if(compiled_)
+                {
+                        ::regfree(&re_);
+                }
+        }
+
+        std::string error;
+
+        /* like re.search */
+        bool search(const std::string& str) const
+        {
+                return ::regexec(&re_, str.c_str(), 0, nullptr, 0) == 0;
+        }
+
+        /* like re.sub: every non-overlapping match replaced, empty matches included */
+        std::string replace(const std::string& str, const std::string& replacement) const
+        {
+                std::string out;
+                std::size_t pos = 0;
+                regmatch_t match;
+                while(pos <= str.size() &&
+                      ::regexec(&re_, str.c_str() + pos, 1, &match, pos == 0 ? 0 : REG_NOTBOL) == 0)
+                {
+                        const auto start = pos + std::size_t(match.rm_so);
+                        const auto end = pos + std::size_t(match.rm_eo);
+                        out.append(str, pos, start - pos);
+                        out += replacement;
+                        pos = end;
+                        if(start == end)
+                        {
+                                /* step over one character so the search moves on */
+                                if(pos < str.size())
+                                {
+                                        out += str[pos];
+                                }
+                                ++pos;
+                        }
+                }
+                if(pos < str.size())
+                {
+                        out.append(str, pos);
+                }
+                return out;
+        }
+
+private:
+        regex_t re_;
+        bool compiled_ = false;
+};
+
+/* Drops the runs whose name `filter` does not match and replaces the matches in the others by
+ * `replacement` */
+static void select_filtered(benchmark_report& report, const filter_regex& filter,
+                            const std::string& replacement)
+{
+        std::erase_if(report.runs,
+                      [&](const benchmark_run& run)
+                      {
+                              return !filter.search(run.name);
+                      });
+        for(auto& run : report.runs)
+        {
+                run.name = filter.replace(run.name, replacement);
+        }
+}
+
+int
+main(int argc, char** argv)
+{
+        options opts;
+        if(!parse_options(argc, argv, opts))
+        {
+                std::fprintf(stderr,
+                             "usage: %s [--repetitions=N] [--alpha=X] [--noise=X] [--markdown=FILE]\n"
+                             "         benchmarks <baseline> <contender> [--benchmark_...]\n"
+                             "       %s [options] filters <binary> <filter_baseline> "
+                             "<filter_contender> [--benchmark_...]\n",
+                             argv[0], argv[0]);
+                return 1;
+        }
+
+        const bool filters = opts.positional[0] == "filters";
+        const auto& filter_old = filters ? opts.positional[2] : std::string();
+        const auto& filter_new = filters ? opts.positional[3] : std::string();
+        const filter_regex re_old(filter_old);
+        const filter_regex re_new(filter_new);
+        for(const auto* re : {&re_old, &re_new})
+        {
+                if(!re->error.empty())
+                {
+                        std::fprintf(stderr, "compare: invalid filter '%s': %s\n",
+                                     (re == &re_old ? filter_old : filter_new).c_str(),
+                                     re->error.c_str());
+                        return 1;
+                }
+        }
+
+        auto old_report = load(opts.positional[1], opts, filter_old);
+        auto new_report =
+            load(filters ? opts.positional[1] : opts.positional[2], opts, filter_new);
+        if(!old_report || !new_report)
+        {
+                return 1;
+        }
+        if(filters)
+        {
+                const auto replacement = '[' + filter_old + " vs. " + filter_new + ']';
+                select_filtered(*old_report, re_old, replacement);
+                select_filtered(*new_report, re_new, replacement);
+        }
+
+        std::vector<comparison> cmps;
+        for(const auto& old_run : old_report->runs)
+        {
+                for(const auto& new_run : new_report->runs)
+                {
+                        if(new_run.name != old_run.name)
+                        {
+                                continue;
+                        }
+                        cmps.push_back(compare_runs(old_run.name, old_run, new_run, opts.noise));
+                        break;
+                }
+        }
+
+        if(cmps.empty())
+        {
+                std::fprintf(stderr, "compare: no benchmark present on both sides\n");
+                return 1;
+        }
+
+        int name_width = int(std::string_view("Benchmark").size());
+        for(const auto& cmp : cmps)
+        {
+                name_width = std::max(name_width, int(cmp.name.size()));
+        }
+        name_width += 5;
+
+        print_terminal(cmps, name_width, opts.alpha);
+
+        if(opts.markdown_path.empty())
+        {
+                std::printf("\n");
+                print_markdown(stdout, cmps, name_width, opts);
+        }
+        else if(std::FILE* out = std::fopen(opts.markdown_path.c_str(), "w"))
+        {
+                print_markdown(out, cmps, name_width, opts);
+                std::fclose(out);
+        }
+        else
+        {
+                std::fprintf(stderr, "compare: cannot write '%s'\n", opts.markdown_path.c_str());
+                return 1;
+        }
+}
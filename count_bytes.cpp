@@ -0,0 +1,469 @@
+/* Counts the occurrences of a byte, or of any byte of a class, in files: by default newlines,
+ * as a drop-in `wc -l`.
+ *
+ * usage: count_bytes [options] [FILE...]
+ *
+ * With no FILE, or when FILE is -, standard input is read.
+ *
+ * options:
+ *   --byte=C        count the byte C (default: \n)
+ *   --class=CHARS   count every byte that appears in CHARS
+ *   --threads=N     split each mmapped file between N pinned threads (default: 1)
+ *   --throughput    print the bytes read, the time taken and GB/s to stderr
+ *
+ * C and CHARS take the escapes \n, \t, \r, \v, \f, \0, \\ and \xHH.
+ *
+ * Regular files are mmapped and counted with count_byte_class (byte_class.hpp), other inputs
+ * are read in blocks. A file truncated while it is mapped (logrotate's copytruncate) raises
+ * SIGBUS on the pages past its new end; the handler jumps out of the scan and the file is counted
+ * again with read(), from the same position, like `wc -l` would have read it.
+ *
+ * The output is that of GNU `wc -l` (coreutils 9): one line per file with the count
+ * right-aligned to a common width, plus a total line if there is more than one FILE. The width
+ * is the number of digits in the summed sizes of the regular files, at least 7 if any input is
+ * not a regular file, and 1 for a single input. File names are printed as given, where wc would
+ * quote those with control characters. Exits with 1 if any input could not be read. */
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "byte_class.hpp"
+#include "cache_padded.hpp"
+#include "thread_pool.hpp"
+
+static constexpr std::size_t READ_BLOCK = 1 << 20;
+
+/* where the SIGBUS handler returns to while this thread reads a mapping, if it does; volatile
+ * so that the stores around the scan are kept */
+static thread_local sigjmp_buf* volatile bus_jump = nullptr;
+
+static void on_sigbus(int)
+{
+        if(bus_jump == nullptr)
+        {
+                std::signal(SIGBUS, SIG_DFL);
+                std::raise(SIGBUS);
+                return;
+        }
+        siglongjmp(*bus_jump, 1);
+}
+
+/* count_byte_class over mapped memory; false if part of it is no longer backed by the file */
+static bool count_mapped_bytes(const std::uint8_t* data, const std::size_t size,
+                               const byte_class& cls, std::uint64_t& result)
+{
+        sigjmp_buf jump;
+        if(sigsetjmp(jump, 1) != 0)
+        {
+                bus_jump = nullptr;
+                return false;
+        }
+        bus_jump = &jump;
+        result = count_byte_class(data, size, cls);
+        bus_jump = nullptr;
+        return true;
+}
+
+struct options
+{
+        std::string chars = "\n";
+        std::size_t threads = 1;
+        bool throughput = false;
+        std::vector<std::string> files;
+};
+
+/* Replaces the escapes of `text` by the bytes they stand for */
+static bool unescape(const std::string_view text, std::string& out)
+{
+        out.clear();
+        for(std::size_t i = 0; i < text.size(); ++i)
+        {
+                if(text[i] != '\\')
+                {
+                        out += text[i];
+                        continue;
+                }
+                if(++i == text.size())
+                {
+                        return false;
+                }
+
+                switch(text[i])
+                {
+                case 'n':
+                        out += '\n';
+                        break;
+                case 't':
+                        out += '\t';
+                        break;
+                case 'r':
+                        out += '\r';
+                        break;
+                case 'v':
+                        out += '\v';
+                        break;
+                case 'f':
+                        out += '\f';
+                        break;
+                case '0':
+                        out += '\0';
+                        break;
+                case '\\':
+                        out += '\\';
+                        break;
+                case 'x':
+                {
+                        const auto digits = text.substr(i + 1, 2);
+                        char* end;
+                        const std::string hex(digits);
+                        const auto value = std::strtoul(hex.c_str(), &end, 16);
+                        if(hex.size() != 2 || *end != '\0')
+                        {
+                                return false;
+                        }
+                        out += char(value);
+                        i += 2;
+                        break;
+                }
+                default:
+                        return false;
+                }
+        }
+        return true;
+}
+
+static bool parse_options(const int argc, char** argv, options& opts)
+{
+        bool only_files = false;
+        for(int i = 1; i < argc; ++i)
+        {
+                const std::string_view arg = argv[i];
+                const auto value = [&arg]()
+                {
+                        return arg.substr(arg.find('=') + 1);
+                };
+
+                if(only_files || arg == "-" || !arg.starts_with("-"))
+                {
+                        opts.files.emplace_back(arg);
+                }
+                else if(arg == "--")
+                {
+                        only_files = true;
+                }
+                else if(arg.starts_with("--byte="))
+                {
+                        if(!unescape(value(), opts.chars) || opts.chars.size() != 1)
+                        {
+                                return false;
+                        }
+                }
+                else if(arg.starts_with("--class="))
+                {
+                        if(!unescape(value(), opts.chars))
+                        {
+                                return false;
+                        }
+                }
+                else if(arg.starts_with("--threads="))
+                {
+                        opts.threads = std::strtoul(std::string(value()).c_str(), nullptr, 10);
+                        if(opts.threads == 0)
+                        {
+                                return false;
+                        }
+                }
+                else if(arg == "--throughput")
+                {
+                        opts.throughput = true;
+                }
+                else
+                {
+                        return false;
+                }
+        }
+        return true;
+}
+
+static void print_error(const std::string& name, const int err)
+{
+        std::fprintf(stderr, "count_bytes: %s: %s\n", name.c_str(), std::strerror(err));
+}
+
+struct input
+{
+        std::string name;
+        int fd = -1;
+        int open_errno = 0;
+        struct stat st;
+        bool stat_ok = false;
+};
+
+/* Same rules as compute_number_width() in coreutils' wc.c */
+static int count_width(const std::vector<input>& inputs)
+{
+        if(inputs.size() == 1)
+        {
+                return 1;
+        }
+
+        int min_width = 1;
+        std::uint64_t regular_total = 0;
+        for(const auto& in : inputs)
+        {
+                if(!in.stat_ok)
+                {
+                        continue;
+                }
+                if(S_ISREG(in.st.st_mode))
+                {
+                        regular_total += std::uint64_t(in.st.st_size);
+                }
+                else
+                {
+                        min_width = 7;
+                }
+        }
+
+        int width = 1;
+        for(; regular_total >= 10; regular_total /= 10)
+        {
+                ++width;
+        }
+        return std::max(width, min_width);
+}
+
+class counter
+{
+public:
+        explicit counter(const options& opts)
+            : cls_(byte_class(
+                  [&opts](const std::uint8_t b)
+                  {
+                          return opts.chars.find(char(b)) != std::string::npos;
+                  })),
+              threads_(opts.threads)
+        {
+                if(threads_ > 1)
+                {
+                        pool_ = std::make_unique<thread_pool>(threads_);
+                }
+
+                struct sigaction sa = {};
+                sa.sa_handler = on_sigbus;
+                sigemptyset(&sa.sa_mask);
+                ::sigaction(SIGBUS, &sa, nullptr);
+        }
+
+        /* The count of `in`, or the errno that stopped the reading (with the count up to there) */
+        int count(const input& in, std::uint64_t& result, std::uint64_t& bytes)
+        {
+                result = 0;
+                bytes = 0;
+                if(S_ISDIR(in.st.st_mode))
+                {
+                        return EISDIR;
+                }
+                if(S_ISREG(in.st.st_mode) && in.st.st_size > 0 && count_mapped(in, result, bytes))
+                {
+                        return 0;
+                }
+                return count_stream(in, result, bytes);
+        }
+
+private:
+        byte_class cls_;
+        std::size_t threads_;
+        std::unique_ptr<thread_pool> pool_;
+        std::vector<std::uint8_t> buffer_;
+
+        /* Counts from the current file position (which standard input may have been left at),
+         * like read() would, and leaves the position at the end of the file. Returns false with
+         * the position unchanged if the file cannot be mapped or shrinks during the count. */
+        bool count_mapped(const input& in, std::uint64_t& result, std::uint64_t& bytes)
+        {
+                const auto offset = ::lseek(in.fd, 0, SEEK_CUR);
+                if(offset < 0 || offset >= in.st.st_size)
+                {
+                        return false;
+                }
+                const auto map_offset = offset & ~off_t(::sysconf(_SC_PAGESIZE) - 1);
+                const auto map_size = std::size_t(in.st.st_size - map_offset);
+                const auto size = std::size_t(in.st.st_size - offset);
+
+                /* a single thread is best served by prefaulting everything in mmap; with several,
+                 * each one faults in its own part */
+                void* map = ::mmap(nullptr, map_size, PROT_READ,
+                                   MAP_PRIVATE | (pool_ ? 0 : MAP_POPULATE), in.fd, map_offset);
+                if(map == MAP_FAILED)
+                {
+                        return false;
+                }
+                ::madvise(map, map_size, MADV_SEQUENTIAL);
+                const auto* data = static_cast<const std::uint8_t*>(map) + (offset - map_offset);
+
+                std::uint64_t count = 0;
+                bool complete = true;
+                if(pool_)
+                {
+                        per_thread<std::uint64_t> counts(pool_->size());
+                        std::atomic<bool> truncated{false};
+                        pool_->parallel_for(0, size,
+                                            [&](const std::size_t first, const std::size_t last,
+                                                const std::size_t idx)
+                                            {
+                                                    if(!count_mapped_bytes(data + first,
+                                                                           last - first, cls_,
+                                                                           counts[idx]))
+                                                    {
+                                                            truncated = true;
+                                                    }
+                                            });
+                        count = counts.combine();
+                        complete = !truncated;
+                }
+                else
+                {
+                        complete = count_mapped_bytes(data, size, cls_, count);
+                }
+
+                ::munmap(map, map_size);
+                if(!complete)
+                {
+                        ::lseek(in.fd, offset, SEEK_SET);
+                        return false;
+                }
+                ::lseek(in.fd, in.st.st_size, SEEK_SET);
+                result = count;
+                bytes = size;
+                return true;
+        }
+
+        int count_stream(const input& in, std::uint64_t& result, std::uint64_t& bytes)
+        {
+                buffer_.resize(READ_BLOCK);
+                for(;;)
+                {
+                        const auto n = ::read(in.fd, buffer_.data(), buffer_.size());
+                        if(n == 0)
+                        {
+                                return 0;
+                        }
+                        if(n < 0)
+                        {
+                                if(errno == EINTR)
+                                {
+                                        continue;
+                                }
+                                return errno;
+                        }
+                        result += count_byte_class(buffer_.data(), std::size_t(n), cls_);
+                        bytes += std::uint64_t(n);
+                }
+        }
+};
+
+int
+main(int argc, char** argv)
+{
+        options opts;
+        if(!parse_options(argc, argv, opts))
+        {
+                std::fprintf(stderr,
+                             "usage: %s [--byte=C | --class=CHARS] [--threads=N] [--throughput] "
+                             "[FILE...]\n",
+                             argv[0]);
+                return 1;
+        }
+
+        /* stat everything first: the width depends on all the sizes */
+        const bool named = !opts.files.empty();
+        std::vector<input> inputs(named ? opts.files.size() : 1);
+        for(std::size_t i = 0; i < inputs.size(); ++i)
+        {
+                auto& in = inputs[i];
+                in.name = named ? opts.files[i] : "";
+                in.fd = !named || in.name == "-" ? STDIN_FILENO : ::open(in.name.c_str(), O_RDONLY);
+                if(in.fd < 0)
+                {
+                        /* wc still counts the size of a file it may not read */
+                        in.open_errno = errno;
+                        in.stat_ok = ::stat(in.name.c_str(), &in.st) == 0;
+                }
+                else
+                {
+                        in.stat_ok = ::fstat(in.fd, &in.st) == 0;
+                }
+        }
+        const int width = count_width(inputs);
+
+        counter cnt(opts);
+        int status = 0;
+        std::uint64_t total = 0;
+        std::uint64_t total_bytes = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for(const auto& in : inputs)
+        {
+                if(in.fd < 0)
+                {
+                        print_error(in.name, in.open_errno);
+                        status = 1;
+                        continue;
+                }
+
+                std::uint64_t result = 0;
+                std::uint64_t bytes = 0;
+                const int err = in.stat_ok ? cnt.count(in, result, bytes) : EIO;
+                if(err != 0)
+                {
+                        print_error(named ? in.name : "-", err);
+                        status = 1;
+                }
+                total += result;
+                total_bytes += bytes;
+
+                std::printf("%*llu", width, (unsigned long long)result);
+                if(named)
+                {
+                        std::printf(" %s", in.name.c_str());
+                }
+                std::printf("\n");
+
+                if(in.fd != STDIN_FILENO)
+                {
+                        ::close(in.fd);
+                }
+        }
+
+        if(inputs.size() > 1)
+        {
+                std::printf("%*llu total\n", width, (unsigned long long)total);
+        }
+
+        if(opts.throughput)
+        {
+                const std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start;
+                std::fprintf(stderr, "count_bytes: %.3f GB in %.3f s, %.2f GB/s, %zu thread(s)\n",
+                             double(total_bytes) / 1e9, elapsed.count(),
+                             double(total_bytes) / 1e9 / elapsed.count(), opts.threads);
+        }
+        return status;
+}
@@ -0,0 +1,307 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+#include "bench_context.hpp"
+#include "cache_padded.hpp"
+#include "thread_pool.hpp"
+
+/* Which way of aggregating a count from many threads wins at which contention level. Every
+ * strategy gets the same update stream: `work` units of private computation, then one update.
+ * Meanwhile a reader thread samples `read()` and compares it with the number of updates the
+ * writers have made (each one publishes its own progress with a relaxed store after every
+ * update); `read_lag_mean` and `read_lag_max` are how many updates the reads were missing. */
+
+static constexpr std::size_t UPDATES = 1 << 12; /* per thread and benchmark iteration */
+
+/* thread-local strategy: updates are published every PUBLISH_EVERY adds (not a divisor of
+ * UPDATES, so that the writers stop at varying points of the publish period) */
+static constexpr std::uint64_t PUBLISH_EVERY = 1000;
+
+static const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+/* Every thread updates one atomic */
+class shared_atomic_counter
+{
+public:
+        explicit shared_atomic_counter(std::size_t)
+        {
+        }
+
+        void add(std::size_t)
+        {
+                total_->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::uint64_t read() const
+        {
+                return total_->load(std::memory_order_relaxed);
+        }
+
+        void flush(std::size_t)
+        {
+        }
+
+private:
+        cache_padded<std::atomic<std::uint64_t>> total_;
+};
+
+/* An atomic in its own padded `Storage` per thread, summed by the reader */
+class padded_atomic_counter
+{
+public:
+        explicit padded_atomic_counter(const std::size_t nthreads)
+            : slots_(nthreads)
+        {
+        }
+
+        void add(const std::size_t idx)
+        {
+                slots_[idx].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::uint64_t read() const
+        {
+                return slots_.combine();
+        }
+
+        void flush(std::size_t)
+        {
+        }
+
+private:
+        per_thread<std::atomic<std::uint64_t>> slots_;
+};
+
+/* Flat combining (Hendler, Incze, Shavit and Tzafrir): a thread posts its update in its own slot;
+ * whoever gets the lock applies every posted update to the total, the others wait for their slot
+ * to be cleared. The total is only written by the lock holder, so it is a plain load and store;
+ * the contended line is touched once per batch instead of once per update. */
+class flat_combining_counter
+{
+public:
+        explicit flat_combining_counter(const std::size_t nthreads)
+            : requests_(nthreads)
+        {
+        }
+
+        void add(const std::size_t idx)
+        {
+                auto& request = requests_[idx];
+                request.store(1, std::memory_order_release);
+
+                for(;;)
+                {
+                        if(!locked_->load(std::memory_order_relaxed) &&
+                           !locked_->exchange(true, std::memory_order_acquire))
+                        {
+                                combine();
+                                locked_->store(false, std::memory_order_release);
+                                return;
+                        }
+                        if(request.load(std::memory_order_acquire) == 0)
+                        {
+                                return;
+                        }
+                        cpu_relax();
+                }
+        }
+
+        std::uint64_t read() const
+        {
+                return total_->load(std::memory_order_relaxed);
+        }
+
+        void flush(std::size_t)
+        {
+        }
+
+private:
+        per_thread<std::atomic<std::uint64_t>> requests_;
+        cache_padded<std::atomic<bool>> locked_;
+        cache_padded<std::atomic<std::uint64_t>> total_;
+
+        void combine()
+        {
+                for(std::size_t i = 0; i < requests_.size(); ++i)
+                {
+                        const auto n = requests_[i].load(std::memory_order_acquire);
+                        if(n == 0)
+                        {
+                                continue;
+                        }
+                        /* the total is updated before the slot is cleared, so a served thread
+                         * reads its own update */
+                        total_->store(total_->load(std::memory_order_relaxed) + n,
+                                      std::memory_order_relaxed);
+                        requests_[i].store(0, std::memory_order_release);
+                }
+        }
+};
+
+/* Plain thread-local count, published to the thread's padded slot every PUBLISH_EVERY updates
+ * and once more at the end (the final reduce sums the slots) */
+class local_publish_counter
+{
+public:
+        explicit local_publish_counter(const std::size_t nthreads)
+            : local_(nthreads)
+            , published_(nthreads)
+        {
+        }
+
+        void add(const std::size_t idx)
+        {
+                if(++local_[idx] == PUBLISH_EVERY)
+                {
+                        flush(idx);
+                }
+        }
+
+        std::uint64_t read() const
+        {
+                return published_.combine();
+        }
+
+        /* single writer per slot: no RMW needed */
+        void flush(const std::size_t idx)
+        {
+                auto& slot = published_[idx];
+                slot.store(slot.load(std::memory_order_relaxed) + local_[idx],
+                           std::memory_order_relaxed);
+                local_[idx] = 0;
+        }
+
+private:
+        per_thread<std::uint64_t> local_;
+        per_thread<std::atomic<std::uint64_t>> published_;
+};
+
+/* `units` steps of a dependent LCG chain: private work the compiler can't drop or overlap with
+ * the next update */
+static std::uint64_t do_work(std::uint64_t x, const std::int64_t units)
+{
+        for(std::int64_t i = 0; i < units; ++i)
+        {
+                x = x * 6364136223846793005ull + 1442695040888963407ull;
+                benchmark::DoNotOptimize(x);
+        }
+        return x;
+}
+
+/* Samples `counter.read()` until stopped; the lag of a sample is how far it is behind the
+ * progress the writers had published before the read started */
+template<typename Strategy>
+class lag_sampler
+{
+public:
+        lag_sampler(const Strategy& counter, const per_thread<std::atomic<std::uint64_t>>& progress)
+            : thread_(
+                  [this, &counter, &progress]
+                  {
+                          run(counter, progress);
+                  })
+        {
+        }
+
+        void stop()
+        {
+                stop_.store(true, std::memory_order_relaxed);
+                thread_.join();
+        }
+
+        double mean() const
+        {
+                return samples_ == 0 ? 0 : double(sum_) / double(samples_);
+        }
+
+        double max() const
+        {
+                return double(max_);
+        }
+
+private:
+        std::atomic<bool> stop_{false};
+        std::uint64_t samples_ = 0;
+        std::uint64_t sum_ = 0;
+        std::uint64_t max_ = 0;
+        std::thread thread_;
+
+        void run(const Strategy& counter, const per_thread<std::atomic<std::uint64_t>>& progress)
+        {
+                while(!stop_.load(std::memory_order_relaxed))
+                {
+                        std::uint64_t done = 0;
+                        for(std::size_t i = 0; i < progress.size(); ++i)
+                        {
+                                done += progress[i].load(std::memory_order_relaxed);
+                        }
+                        const auto seen = counter.read();
+                        const auto lag = done > seen ? done - seen : 0;
+                        sum_ += lag;
+                        max_ = std::max(max_, lag);
+                        ++samples_;
+                        cpu_relax();
+                }
+        }
+};
+
+template<typename Strategy>
+static void contention(benchmark::State& state)
+{
+        /* both live across runs: the totals keep growing, and stay equal between runs */
+        static Strategy counter{max_threads};
+        static per_thread<std::atomic<std::uint64_t>> progress(max_threads);
+        static std::optional<lag_sampler<Strategy>> sampler;
+
+        const auto idx = std::size_t(state.thread_index());
+        const auto work = state.range(0);
+        auto& own_progress = progress[idx];
+        std::uint64_t x = idx;
+
+        if(idx == 0)
+        {
+                sampler.emplace(counter, progress);
+        }
+
+        for(auto _ : state)
+        {
+                for(std::size_t i = 0; i < UPDATES; ++i)
+                {
+                        x = do_work(x, work);
+                        counter.add(idx);
+                        own_progress.store(own_progress.load(std::memory_order_relaxed) + 1,
+                                           std::memory_order_relaxed);
+                }
+        }
+
+        /* the loop ends with a barrier: every writer is done */
+        if(idx == 0)
+        {
+                sampler->stop();
+                state.counters["read_lag_mean"] = sampler->mean();
+                state.counters["read_lag_max"] = sampler->max();
+                sampler.reset();
+        }
+        counter.flush(idx);
+        benchmark::DoNotOptimize(counter.read());
+
+        state.counters["updates_per_second"] =
+            benchmark::Counter(double(state.iterations() * UPDATES), benchmark::Counter::kIsRate);
+}
+
+static void sweep(benchmark::internal::Benchmark* b)
+{
+        b->ArgName("work")->RangeMultiplier(8)->Range(0, 512);
+        b->DenseThreadRange(1, int(max_threads))->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(contention, shared_atomic_counter)->Apply(sweep);
+BENCHMARK_TEMPLATE(contention, padded_atomic_counter)->Apply(sweep);
+BENCHMARK_TEMPLATE(contention, flat_combining_counter)->Apply(sweep);
+BENCHMARK_TEMPLATE(contention, local_publish_counter)->Apply(sweep);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,502 @@
+#pragma once
+
+/* Reproducible benchmark datasets.
+ *
+ * Values are produced by a counter-based generator: element `i` depends only on `(seed, i)`,
+ * so any subrange can be generated independently of the others and the whole dataset is filled
+ * in parallel, with bit-for-bit identical results regardless of the thread count.
+ *
+ * Generated datasets are stored in a binary cache file and mmapped on later runs. The cache
+ * directory is `$CPP_MISC_DATASET_DIR`, `$XDG_CACHE_HOME/cpp-misc` or `$HOME/.cache/cpp-misc`
+ * (first one set). Setting `CPP_MISC_DATASET_DIR` to an empty string disables the cache. */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* SplitMix64 finalizer applied to `seed + counter * golden_gamma` */
+constexpr std::uint64_t counter_hash(const std::uint64_t seed, const std::uint64_t counter)
+{
+        std::uint64_t z = seed + (counter + 1) * 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+}
+
+template<typename T>
+class dataset
+{
+public:
+        dataset() = default;
+
+        explicit dataset(std::vector<T> owned)
+            : owned_(std::move(owned))
+            , data_(owned_.data())
+            , size_(owned_.size())
+        {
+        }
+
+        dataset(void* map, const std::size_t map_size, const T* data, const std::size_t size)
+            : map_(map)
+            , map_size_(map_size)
+            , data_(data)
+            , size_(size)
+        {
+        }
+
+        dataset(dataset&& other) noexcept
+            : owned_(std::move(other.owned_))
+            , map_(std::exchange(other.map_, nullptr))
+            , map_size_(std::exchange(other.map_size_, 0))
+            , data_(std::exchange(other.data_, nullptr))
+            , size_(std::exchange(other.size_, 0))
+        {
+        }
+
+        dataset& operator=(dataset&& other) noexcept
+        {
+                std::swap(owned_, other.owned_);
+                std::swap(map_, other.map_);
+                std::swap(map_size_, other.map_size_);
+                std::swap(data_, other.data_);
+                std::swap(size_, other.size_);
+                return *this;
+        }
+
+        ~dataset()
+        {
+                if(map_ != nullptr)
+                {
+                        ::munmap(map_, map_size_);
+                }
+        }
+
+        const T* data() const
+        {
+                return data_;
+        }
+
+        std::size_t size() const
+        {
+                return size_;
+        }
+
+        const T* begin() const
+        {
+                return data_;
+        }
+
+        const T* end() const
+        {
+                return data_ + size_;
+        }
+
+        const T& operator[](const std::size_t idx) const
+        {
+                return data_[idx];
+        }
+
+        operator std::span<const T>() const
+        {
+                return {data_, size_};
+        }
+
+private:
+        std::vector<T> owned_;
+        void* map_ = nullptr;
+        std::size_t map_size_ = 0;
+        const T* data_ = nullptr;
+        std::size_t size_ = 0;
+};
+
+/* Calls `fill(first, last)` on disjoint subranges of [0, size) from all hardware threads */
+template<typename Fill>
+void parallel_fill(const std::size_t size, const Fill& fill)
+{
+        const std::size_t nthreads =
+            std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 64);
+        const std::size_t chunk = (size + nthreads - 1) / nthreads;
+
+        std::vector<std::thread> threads;
+        for(std::size_t first = 0; first < size; first += chunk)
+        {
+                threads.emplace_back(fill, first, std::min(first + chunk, size));
+        }
+        for(auto& t : threads)
+        {
+                t.join();
+        }
+}
+
+/* What a dataset is generated from besides the seed and size. All of it goes into the cache file
+ * name and header, so datasets generated with different parameters never share a file;
+ * parameters the generator doesn't use are left at 0. */
+struct dataset_key
+{
+        std::string kind; /* at most 31 characters */
+        double match_probability = 0;
+        std::uint64_t run_length = 0;
+};
+
+struct dataset_file_header
+{
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t element_size;
+        std::uint64_t seed;
+        std::uint64_t size;
+        char kind[32];
+        double match_probability;
+        std::uint64_t run_length;
+        char padding[48];
+};
+static_assert(sizeof(dataset_file_header) == 128, "keeps the mmapped data 64-byte aligned");
+
+static constexpr char DATASET_MAGIC[8] = {'c', 'p', 'p', 'm', 'd', 's', 'e', 't'};
+static constexpr std::uint32_t DATASET_VERSION = 2;
+
+inline std::string dataset_cache_dir()
+{
+        if(const char* dir = std::getenv("CPP_MISC_DATASET_DIR"))
+        {
+                return dir;
+        }
+        if(const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0')
+        {
+                return std::string(xdg) + "/cpp-misc";
+        }
+        if(const char* home = std::getenv("HOME"); home != nullptr && *home != '\0')
+        {
+                return std::string(home) + "/.cache/cpp-misc";
+        }
+        return {};
+}
+
+/* mkdir -p */
+inline bool make_dirs(const std::string& path)
+{
+        for(std::size_t pos = 1; pos <= path.size(); ++pos)
+        {
+                if(pos == path.size() || path[pos] == '/')
+                {
+                        const auto prefix = path.substr(0, pos);
+                        if(::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+                        {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+
+template<typename T>
+dataset<T> map_dataset_file(const std::string& path, const dataset_key& key,
+                            const std::uint64_t seed, const std::size_t size)
+{
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+                return {};
+        }
+
+        const std::size_t map_size = sizeof(dataset_file_header) + size * sizeof(T);
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || std::size_t(st.st_size) != map_size)
+        {
+                ::close(fd);
+                return {};
+        }
+
+        void* map = ::mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if(map == MAP_FAILED)
+        {
+                return {};
+        }
+
+        dataset_file_header header;
+        std::memcpy(&header, map, sizeof(header));
+        if(std::memcmp(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0 ||
+           header.version != DATASET_VERSION || header.element_size != sizeof(T) ||
+           header.seed != seed || header.size != size ||
+           std::string(header.kind, strnlen(header.kind, sizeof(header.kind))) != key.kind ||
+           header.match_probability != key.match_probability ||
+           header.run_length != key.run_length)
+        {
+                ::munmap(map, map_size);
+                return {};
+        }
+
+        const auto* data =
+            reinterpret_cast<const T*>(static_cast<const char*>(map) + sizeof(header));
+        return {map, map_size, data, size};
+}
+
+/* Best effort: a failure only means the next run generates the data again */
+template<typename T>
+void write_dataset_file(const std::string& path, const dataset_key& key,
+                        const std::uint64_t seed, const std::span<const T> data)
+{
+        dataset_file_header header{};
+        std::memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+        header.version = DATASET_VERSION;
+        header.element_size = sizeof(T);
+        header.seed = seed;
+        header.size = data.size();
+        key.kind.copy(header.kind, sizeof(header.kind) - 1);
+        header.match_probability = key.match_probability;
+        header.run_length = key.run_length;
+
+        /* written under a unique name and renamed, so concurrent runs never see a partial file */
+        const auto tmp = path + ".tmp." + std::to_string(::getpid());
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0)
+        {
+                return;
+        }
+
+        const auto write_all = [fd](const void* buf, std::size_t len)
+        {
+                const auto* ptr = static_cast<const char*>(buf);
+                while(len != 0)
+                {
+                        const auto written = ::write(fd, ptr, len);
+                        if(written <= 0)
+                        {
+                                return false;
+                        }
+                        ptr += written;
+                        len -= std::size_t(written);
+                }
+                return true;
+        };
+
+        const bool ok =
+            write_all(&header, sizeof(header)) && write_all(data.data(), data.size_bytes());
+        if(::close(fd) != 0 || !ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+        {
+                std::remove(tmp.c_str());
+        }
+}
+
+/* Loads dataset `key` from the cache, or fills it with `value(i)` for every index, applies
+ * `finalize` to the whole span and caches it. `value` must be a pure function of the index (and
+ * of `seed`), i.e. counter-based; `key` must uniquely identify the generator and its
+ * parameters. */
+template<typename T, typename Generator, typename Finalize>
+dataset<T> load_dataset(const dataset_key& key, const std::size_t size, const std::uint64_t seed,
+                        const Generator& value, const Finalize& finalize)
+{
+        auto dir = dataset_cache_dir();
+        std::string path;
+        if(!dir.empty() && make_dirs(dir))
+        {
+                /* %.17g keeps every bit of the probability */
+                char params[64];
+                std::snprintf(params, sizeof(params), "-p%.17g-r%llu", key.match_probability,
+                              (unsigned long long)key.run_length);
+                path = dir + '/' + key.kind + params + '-' + std::to_string(sizeof(T) * 8) +
+                       "bit-" + std::to_string(size) + '-' + std::to_string(seed) + ".bin";
+                if(auto cached = map_dataset_file<T>(path, key, seed, size);
+                   cached.data() != nullptr)
+                {
+                        return cached;
+                }
+        }
+
+        std::vector<T> vec(size);
+        parallel_fill(size,
+                      [&](const std::size_t first, const std::size_t last)
+                      {
+                              for(std::size_t i = first; i != last; ++i)
+                              {
+                                      vec[i] = value(i);
+                              }
+                      });
+        finalize(std::span<T>{vec});
+
+        if(!path.empty())
+        {
+                write_dataset_file<T>(path, key, seed, vec);
+        }
+        return dataset<T>{std::move(vec)};
+}
+
+template<typename T, typename Generator>
+dataset<T> load_dataset(const dataset_key& key, const std::size_t size, const std::uint64_t seed,
+                        const Generator& value)
+{
+        return load_dataset<T>(key, size, seed, value, [](std::span<T>) {});
+}
+
+/* Uniformly distributed values over the whole range of T */
+template<typename T>
+dataset<T> uniform_dataset(const std::size_t size, const std::uint64_t seed)
+{
+        return load_dataset<T>({"uniform"}, size, seed,
+                               [seed](const std::size_t i)
+                               {
+                                       return static_cast<T>(counter_hash(seed, i));
+                               });
+}
+
+/* Value distributions for predicate benchmarks. A value "matches" when it is even, which is what
+ * the `is_even` predicates used throughout the benchmarks test for. */
+enum class distribution
+{
+        uniform,           /* uniform over T, ~50% matches in random order */
+        all_even,          /* every value matches */
+        all_odd,           /* no value matches */
+        alternating,       /* even, odd, even, odd, ... */
+        long_runs,         /* runs of `run_length` values with the same (random) parity */
+        sorted,            /* values matching with `match_probability`, all the matches first */
+        match_probability, /* each value matches independently with `match_probability` */
+        /* skewed values, for histograms (parity is random) */
+        zipf,      /* 2^ZIPF_BITS distinct values, the r-th most common with frequency ~1/r */
+        hot_value, /* one value with probability `match_probability`, uniform otherwise */
+};
+
+/* log2 of the number of distinct values in distribution::zipf */
+inline constexpr unsigned ZIPF_BITS = 20;
+
+struct distribution_params
+{
+        distribution kind = distribution::uniform;
+        double match_probability = 0.5;
+        std::size_t run_length = 4096;
+};
+
+/* e.g. "uniform", "long_runs_4096", "match_p0.250"; used in cache file names and benchmark
+ * labels */
+inline std::string distribution_name(const distribution_params& params)
+{
+        switch(params.kind)
+        {
+        case distribution::uniform:
+                return "uniform";
+        case distribution::all_even:
+                return "all_even";
+        case distribution::all_odd:
+                return "all_odd";
+        case distribution::alternating:
+                return "alternating";
+        case distribution::long_runs:
+                return "long_runs_" + std::to_string(params.run_length);
+        case distribution::sorted:
+        case distribution::match_probability:
+        case distribution::hot_value:
+        {
+                const char* prefix = params.kind == distribution::sorted            ? "sorted"
+                                     : params.kind == distribution::match_probability ? "match"
+                                                                                      : "hot";
+                char buf[32];
+                std::snprintf(buf, sizeof(buf), "%s_p%.3f", prefix, params.match_probability);
+                return buf;
+        }
+        case distribution::zipf:
+                return "zipf";
+        }
+        return "unknown";
+}
+
+/* Uniform double in [0, 1) from the top 53 bits of a hash */
+constexpr double counter_unit(const std::uint64_t seed, const std::uint64_t counter)
+{
+        return double(counter_hash(seed, counter) >> 11) * 0x1.0p-53;
+}
+
+template<typename T>
+dataset<T> distribution_dataset(const std::size_t size, const std::uint64_t seed,
+                                const distribution_params& params)
+{
+        /* independent streams for the parity decisions and for the skewed values */
+        const std::uint64_t parity_seed = counter_hash(seed, ~0ull);
+        const std::uint64_t value_seed = counter_hash(seed, ~1ull);
+
+        const auto with_parity = [](const std::uint64_t bits, const bool even)
+        {
+                return static_cast<T>((bits & ~std::uint64_t(1)) | std::uint64_t(!even));
+        };
+
+        const auto value = [=](const std::size_t i) -> T
+        {
+                const auto bits = counter_hash(seed, i);
+                switch(params.kind)
+                {
+                case distribution::uniform:
+                        return static_cast<T>(bits);
+                case distribution::all_even:
+                        return with_parity(bits, true);
+                case distribution::all_odd:
+                        return with_parity(bits, false);
+                case distribution::alternating:
+                        return with_parity(bits, i % 2 == 0);
+                case distribution::long_runs:
+                {
+                        const auto run = i / std::max<std::size_t>(params.run_length, 1);
+                        return with_parity(bits, counter_hash(parity_seed, run) % 2 == 0);
+                }
+                case distribution::match_probability:
+                case distribution::sorted:
+                        return with_parity(bits,
+                                           counter_unit(parity_seed, i) < params.match_probability);
+                case distribution::zipf:
+                {
+                        /* a uniform exponent gives rank r in [1, 2^ZIPF_BITS) a density ~1/r */
+                        const auto rank =
+                            std::uint64_t(std::exp2(ZIPF_BITS * counter_unit(parity_seed, i)));
+                        return static_cast<T>(counter_hash(value_seed, rank));
+                }
+                case distribution::hot_value:
+                        return counter_unit(parity_seed, i) < params.match_probability
+                                   ? static_cast<T>(counter_hash(value_seed, 0))
+                                   : static_cast<T>(bits);
+                }
+                return static_cast<T>(bits);
+        };
+
+        /* sorted by the predicate's outcome, not by magnitude (which leaves the parity random):
+         * the matches, then the others, each ascending */
+        const auto finalize = [&params](const std::span<T> data)
+        {
+                if(params.kind == distribution::sorted)
+                {
+                        std::sort(data.begin(), data.end(),
+                                  [](const T a, const T b)
+                                  {
+                                          return std::pair(a & 1, a) < std::pair(b & 1, b);
+                                  });
+                }
+        };
+
+        dataset_key key{distribution_name(params)};
+        if(params.kind == distribution::long_runs)
+        {
+                key = {"long_runs", 0, params.run_length};
+        }
+        else if(params.kind == distribution::sorted ||
+                params.kind == distribution::match_probability)
+        {
+                key = {params.kind == distribution::sorted ? "sorted" : "match_probability",
+                       params.match_probability};
+        }
+        else if(params.kind == distribution::hot_value)
+        {
+                key = {"hot_value", params.match_probability};
+        }
+        return load_dataset<T>(key, size, seed, value, finalize);
+}
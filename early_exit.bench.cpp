@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "early_exit.hpp"
+
+static constexpr std::size_t SIZE = 1 << 20;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+/* All odd; each benchmark places one even element at `position` (SIZE: no match) */
+static std::vector<int> test_vec = []
+{
+        const auto odd = distribution_dataset<int>(SIZE, SEED, {distribution::all_odd});
+        return std::vector<int>(odd.begin(), odd.end());
+}();
+
+static constexpr auto is_even_int = [](const int el) -> int
+{
+        return el % 2 == 0;
+};
+
+static constexpr auto is_even_bool = [](const int el) -> bool
+{
+        return el % 2 == 0;
+};
+
+template<typename Find>
+static void run(benchmark::State& state, const Find& find)
+{
+        /* flipping the low bit makes the odd element even without overflowing INT_MAX */
+        const auto position = std::size_t(state.range(0));
+        if(position < SIZE)
+        {
+                test_vec[position] ^= 1;
+        }
+
+        for(auto _ : state)
+        {
+                const auto it = find(test_vec.cbegin(), test_vec.cend());
+                benchmark::DoNotOptimize(it);
+        }
+
+        if(position < SIZE)
+        {
+                test_vec[position] ^= 1;
+        }
+
+        /* elements up to and including the match */
+        state.SetBytesProcessed(int64_t(state.iterations()) *
+                                int64_t(std::min(position + 1, SIZE) * sizeof(int)));
+}
+
+static void std_find_if(benchmark::State& state)
+{
+        run(state,
+            [](const auto first, const auto last)
+            {
+                    return std::find_if(first, last, is_even_int);
+            });
+}
+
+template<std::size_t BLOCK>
+static void chunked_int(benchmark::State& state)
+{
+        run(state,
+            [](const auto first, const auto last)
+            {
+                    return chunked_find_if<BLOCK>(first, last, is_even_int);
+            });
+}
+
+/* a `bool` predicate: the block reduction is no longer vectorized */
+static void chunked_bool(benchmark::State& state)
+{
+        run(state,
+            [](const auto first, const auto last)
+            {
+                    return chunked_find_if(first, last, is_even_bool);
+            });
+}
+
+static void positions(benchmark::internal::Benchmark* b)
+{
+        b->ArgName("match_at");
+        // clang-format off
+        const std::size_t match_at[] = {0, 7, 63, 100, 1000,
+                                        SIZE / 16, SIZE / 2, SIZE - 1, SIZE};
+        // clang-format on
+        for(const auto position : match_at)
+        {
+                b->Arg(int64_t(position));
+        }
+}
+
+BENCHMARK(std_find_if)->Apply(positions);
+BENCHMARK_TEMPLATE(chunked_int, 16)->Apply(positions);
+BENCHMARK_TEMPLATE(chunked_int, 64)->Apply(positions);
+BENCHMARK_TEMPLATE(chunked_int, 256)->Apply(positions);
+BENCHMARK(chunked_bool)->Apply(positions);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,52 @@
+#pragma once
+
+/* `find_if`/`any_of` that GCC can vectorize. A loop with an early `break` is never vectorized, so
+ * the predicate is OR-reduced over a whole block of BLOCK elements first (a branch-free loop with
+ * a fixed trip count, vectorized like `count_if` as long as the predicate doesn't return `bool`,
+ * see iter_pred.hpp); only a block with a hit is scanned element by element. Elements after the
+ * match, up to the end of its block, are evaluated too, so the predicate must be free of side
+ * effects. */
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+#include "iter_pred.hpp"
+
+template<std::size_t BLOCK = 64, std::random_access_iterator It, typename Pred>
+It chunked_find_if(It first, const It last, Pred pred)
+{
+        static_assert(BLOCK > 0);
+        const _Iter_pred_auto it_pred{pred};
+        using result_type = decltype(it_pred(first));
+
+        while(last - first >= std::ptrdiff_t(BLOCK))
+        {
+                result_type any{};
+                for(std::size_t i = 0; i < BLOCK; ++i)
+                {
+                        any |= it_pred(first + std::ptrdiff_t(i));
+                }
+                if(any)
+                {
+                        break;
+                }
+                first += std::ptrdiff_t(BLOCK);
+        }
+
+        /* the block with the match (if any), then the tail */
+        for(; first != last; ++first)
+        {
+                if(it_pred(first))
+                {
+                        break;
+                }
+        }
+        return first;
+}
+
+template<std::size_t BLOCK = 64, std::random_access_iterator It, typename Pred>
+bool chunked_any_of(const It first, const It last, Pred pred)
+{
+        return chunked_find_if<BLOCK>(first, last, pred) != last;
+}
@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "bench_context.hpp"
+#include "optimization_barrier.hpp"
+#include "thread_pool.hpp"
+
+/* Every thread increments its own counter; counters are `STRIDE` bytes apart. With strides below
+ * the cache line size, several threads write to the same line. */
+template<std::size_t STRIDE, typename T>
+struct alignas(STRIDE) Storage
+{
+        T val{0};
+};
+
+enum class mode
+{
+        plain,
+        relaxed_store,
+        volatile_store,
+        relaxed_atomic,
+        seq_cst_atomic,
+};
+
+static const char* mode_name(const mode m)
+{
+        switch(m)
+        {
+        case mode::plain:
+                return "plain";
+        case mode::relaxed_store:
+                return "relaxed_store";
+        case mode::volatile_store:
+                return "volatile";
+        case mode::relaxed_atomic:
+                return "relaxed_atomic";
+        case mode::seq_cst_atomic:
+                return "seq_cst_atomic";
+        }
+        return "";
+}
+
+static constexpr std::size_t MAX_THREADS = 256;
+static constexpr std::size_t INCREMENTS = 1 << 16; /* per thread and benchmark iteration */
+
+static const std::size_t max_threads =
+    std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, MAX_THREADS);
+
+/* Pinned workers that outlive the benchmarks: no thread creation or migration in the runs */
+static thread_pool pool(max_threads);
+
+template<std::size_t STRIDE, mode MODE>
+static void increment(benchmark::State& state)
+{
+        using value_type = std::conditional_t<MODE == mode::relaxed_atomic ||
+                                                  MODE == mode::seq_cst_atomic,
+                                              std::atomic<std::uint64_t>, std::uint64_t>;
+
+        /* the same base alignment for every stride, so only the stride changes */
+        struct alignas(256) storage_array
+        {
+                Storage<STRIDE, value_type> slots[MAX_THREADS];
+        };
+        static storage_array results;
+
+        const auto work = [](const std::size_t idx)
+        {
+                auto& ref = results.slots[idx].val;
+                for(std::size_t i = 0; i < INCREMENTS; ++i)
+                {
+                        if constexpr(MODE == mode::plain)
+                        {
+                                ++ref;
+                                clobber_memory();
+                        }
+                        else if constexpr(MODE == mode::relaxed_store)
+                        {
+                                relaxed_store(ref, relaxed_load(ref) + 1);
+                        }
+                        else if constexpr(MODE == mode::volatile_store)
+                        {
+                                auto& vref = const_cast<volatile std::uint64_t&>(ref);
+                                vref = vref + 1;
+                        }
+                        else if constexpr(MODE == mode::relaxed_atomic)
+                        {
+                                ref.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        else
+                        {
+                                ref.fetch_add(1, std::memory_order_seq_cst);
+                        }
+                }
+        };
+
+        const auto nthreads = std::size_t(state.range(0));
+        for(auto _ : state)
+        {
+                pool.run(nthreads, work);
+        }
+
+        /* every worker did INCREMENTS per iteration */
+        state.counters["incr_per_second_per_thread"] = benchmark::Counter(
+            double(state.iterations() * INCREMENTS), benchmark::Counter::kIsRate);
+}
+
+template<std::size_t STRIDE, mode MODE>
+static void register_one()
+{
+        const auto name =
+            std::string("false_sharing/") + mode_name(MODE) + "/stride:" + std::to_string(STRIDE);
+
+        benchmark::RegisterBenchmark(name.c_str(), increment<STRIDE, MODE>)
+            ->ArgName("threads")
+            ->DenseRange(1, int64_t(max_threads))
+            ->UseRealTime();
+}
+
+template<std::size_t... STRIDES>
+static bool register_all()
+{
+        (register_one<STRIDES, mode::plain>(), ...);
+        (register_one<STRIDES, mode::relaxed_store>(), ...);
+        (register_one<STRIDES, mode::volatile_store>(), ...);
+        (register_one<STRIDES, mode::relaxed_atomic>(), ...);
+        (register_one<STRIDES, mode::seq_cst_atomic>(), ...);
+        return true;
+}
+
+static const bool registered = register_all<8, 16, 32, 64, 128, 256>();
+
+BENCHMARK_MAIN();
@@ -1,41 +1,151 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
-#include <thread>
+#include <optional>
+#include <utility>
+#include <vector>
 
-/* GNU specific */
-#define DO_NOT_OPTIMIZE __attribute__((optimize("O0")))
+#include "cache_layout.hpp"
+#include "cache_padded.hpp"
+#include "optimization_barrier.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
 
-/* Try with: `alignas(64)` */
 struct alignas(8) Storage
 {
         std::uint64_t val{0};
 };
 
+static constexpr field_info storage_fields[] = {CACHE_LAYOUT_FIELD(Storage, val, 0)};
+ASSERT_NO_FALSE_SHARING(storage_fields, alignof(Storage));
+
+/* All four counters share a cache line */
 static Storage results[4] = {};
 
-static void DO_NOT_OPTIMIZE
-do_stuff(const std::size_t idx)
+static constexpr auto results_fields = array_fields<Storage, 4>("results");
+static_assert(!writers_separated(results_fields, 64, alignof(Storage)),
+              "the unpadded counters are meant to share a line");
+
+/* Every counter on its own (pair of) cache line(s) */
+static per_thread<Storage> padded_results(4);
+
+static constexpr auto padded_fields = array_fields<cache_padded<Storage>, 4>("padded_results");
+ASSERT_NO_FALSE_SHARING(padded_fields, alignof(cache_padded<Storage>));
+
+/* Four workers pinned to the first four CPUs, created once for both runs */
+static thread_pool pool(4);
+
+template<typename Results>
+static void
+do_stuff(Results& res, const std::size_t idx)
 {
-        auto& ref = results[idx];
+        auto& ref = res[idx];
 
         for(std::size_t i = 0; i < 1 << 26; ++i)
         {
                 ++ref.val;
+                /* the increment stays a read-modify-write of memory, nothing else is added */
+                clobber_memory();
+        }
+}
+
+template<typename Results>
+static std::chrono::milliseconds
+time_run(thread_pool& workers, Results& res)
+{
+        const auto start = std::chrono::steady_clock::now();
+
+        workers.run(
+            [&res](const std::size_t idx)
+            {
+                    do_stuff(res, idx);
+            });
+
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+}
+
+template<typename Results>
+static void
+run(const char* name, Results& res)
+{
+        std::cout << name << ": " << time_run(pool, res).count() << " ms\n";
+}
+
+/* First pair of CPUs we may run on that are `distance` apart */
+static std::optional<std::pair<int, int>>
+find_pair(const std::vector<cpu_location>& locations, const cpu_distance distance)
+{
+        for(std::size_t i = 0; i < locations.size(); ++i)
+        {
+                for(std::size_t j = i + 1; j < locations.size(); ++j)
+                {
+                        if(distance_between(locations[i], locations[j]) == distance)
+                        {
+                                return std::pair{locations[i].cpu, locations[j].cpu};
+                        }
+                }
+        }
+        return std::nullopt;
+}
+
+/* Two threads pinned at each distance: sibling hyperthreads share L1, so the shared line should
+ * cost little there, and most across packages */
+static void
+run_placements()
+{
+        const auto allowed = allowed_cpus();
+        std::vector<cpu_location> locations;
+        for(const auto& loc : detect_cpu_locations())
+        {
+                if(std::find(allowed.begin(), allowed.end(), loc.cpu) != allowed.end())
+                {
+                        locations.push_back(loc);
+                }
+        }
+
+        std::cout << "\nshared line cost by placement (2 threads):\n";
+        for(const auto distance : {cpu_distance::smt_siblings, cpu_distance::same_l3,
+                                   cpu_distance::same_package, cpu_distance::different_package})
+        {
+                const auto pair = find_pair(locations, distance);
+                if(!pair)
+                {
+                        std::cout << cpu_distance_name(distance) << ": no such CPU pair, skipped\n";
+                        continue;
+                }
+
+                thread_pool placed(std::vector<int>{pair->first, pair->second});
+                const auto shared = time_run(placed, results);
+                const auto padded = time_run(placed, padded_results);
+                const auto padded_nonzero = std::max(padded, std::chrono::milliseconds{1});
+                const auto slowdown = double(shared.count()) / double(padded_nonzero.count());
+                std::cout << cpu_distance_name(distance) << " (CPUs " << pair->first << ", "
+                          << pair->second << "): shared line " << shared.count() << " ms, padded "
+                          << padded.count() << " ms, " << slowdown << "x\n";
         }
 }
 
 int
 main()
 {
-        std::thread t0(do_stuff, 0);
-        std::thread t1(do_stuff, 1);
-        std::thread t2(do_stuff, 2);
-        std::thread t3(do_stuff, 3);
+        print_cache_layout(std::cout, "results", results_fields, alignof(Storage));
+        print_cache_layout(std::cout, "padded_results", padded_fields,
+                           alignof(cache_padded<Storage>));
+        std::cout << '\n';
 
-        t0.join();
-        t1.join();
-        t2.join();
-        t3.join();
+        run("shared line", results);
+        run("padded", padded_results);
 
+        /* the placement runs below reuse both arrays, so the totals are printed before them */
         std::cout << results[0].val + results[1].val + results[2].val + results[3].val << '\n';
+        std::cout << padded_results.combine(std::uint64_t{0},
+                                            [](const std::uint64_t sum, const Storage& s)
+                                            {
+                                                    return sum + s.val;
+                                            })
+                  << '\n';
+
+        run_placements();
 }
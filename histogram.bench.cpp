@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "histogram.hpp"
+#include "optimization_barrier.hpp"
+
+static constexpr std::size_t SIZE = 1 << 22;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+/* Uniform values spread evenly over the buckets; the skewed ones send runs of values to the same
+ * bucket, the case where the scalar loop waits on store forwarding */
+static const distribution_params DISTRIBUTIONS[] = {
+    {distribution::uniform},
+    {distribution::zipf},
+    {distribution::hot_value, 0.5},
+    {distribution::hot_value, 0.9},
+};
+
+static const auto test_vecs = []
+{
+        std::vector<dataset<std::uint32_t>> vecs;
+        for(const auto& params : DISTRIBUTIONS)
+        {
+                vecs.push_back(distribution_dataset<std::uint32_t>(SIZE, SEED, params));
+        }
+        return vecs;
+}();
+
+/* state.range(0) is the bucket count, a power of two, and state.range(1) the distribution */
+static top_bits_buckets top_bits(const benchmark::State& state)
+{
+        return {unsigned(std::countr_zero(std::uint64_t(state.range(0))))};
+}
+
+static mod_buckets mod(const benchmark::State& state)
+{
+        return {std::uint32_t(state.range(0))};
+}
+
+template<typename Kernel>
+static void run(benchmark::State& state, const Kernel& kernel)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(1))];
+        std::vector<std::uint32_t> counts(std::size_t(state.range(0)));
+
+        for(auto _ : state)
+        {
+                std::fill(counts.begin(), counts.end(), 0);
+                kernel(std::span<const std::uint32_t>(vec), std::span<std::uint32_t>(counts));
+                benchmark::DoNotOptimize(counts.data());
+                clobber_memory();
+        }
+
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(SIZE));
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(1)]));
+}
+
+static void scalar_top_bits(benchmark::State& state)
+{
+        run(state,
+            [bucket = top_bits(state)](const auto data, const auto counts)
+            {
+                    histogram_scalar(data, bucket, counts);
+            });
+}
+
+static void scalar_mod(benchmark::State& state)
+{
+        run(state,
+            [bucket = mod(state)](const auto data, const auto counts)
+            {
+                    histogram_scalar(data, bucket, counts);
+            });
+}
+
+template<std::size_t COPIES>
+static void replicated_top_bits(benchmark::State& state)
+{
+        run(state,
+            [bucket = top_bits(state)](const auto data, const auto counts)
+            {
+                    histogram_replicated<COPIES>(data, bucket, counts);
+            });
+}
+
+template<std::size_t COPIES>
+static void replicated_mod(benchmark::State& state)
+{
+        run(state,
+            [bucket = mod(state)](const auto data, const auto counts)
+            {
+                    histogram_replicated<COPIES>(data, bucket, counts);
+            });
+}
+
+#if defined(__AVX512CD__)
+static void conflict_top_bits(benchmark::State& state)
+{
+        run(state,
+            [bucket = top_bits(state)](const auto data, const auto counts)
+            {
+                    histogram_conflict(data, bucket, counts);
+            });
+}
+
+static void conflict_mod(benchmark::State& state)
+{
+        run(state,
+            [bucket = mod(state)](const auto data, const auto counts)
+            {
+                    histogram_conflict(data, bucket, counts);
+            });
+}
+#endif
+
+static void buckets(benchmark::internal::Benchmark* b)
+{
+        b->ArgNames({"buckets", "distribution"});
+        b->ArgsProduct({benchmark::CreateRange(2, 65536, 2),
+                        benchmark::CreateDenseRange(0, std::size(DISTRIBUTIONS) - 1, 1)});
+}
+
+BENCHMARK(scalar_top_bits)->Apply(buckets);
+BENCHMARK_TEMPLATE(replicated_top_bits, 4)->Apply(buckets);
+BENCHMARK_TEMPLATE(replicated_top_bits, 8)->Apply(buckets);
+BENCHMARK(scalar_mod)->Apply(buckets);
+BENCHMARK_TEMPLATE(replicated_mod, 4)->Apply(buckets);
+BENCHMARK_TEMPLATE(replicated_mod, 8)->Apply(buckets);
+#if defined(__AVX512CD__)
+BENCHMARK(conflict_top_bits)->Apply(buckets);
+BENCHMARK(conflict_mod)->Apply(buckets);
+#endif
+
+BENCHMARK_MAIN();
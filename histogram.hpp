@@ -0,0 +1,145 @@
+#pragma once
+
+/* Counting 32-bit values per bucket. The plain loop `++counts[bucket(x)]` stalls whenever
+ * consecutive values land in the same bucket: each increment has to wait for the previous store
+ * to the same counter to be forwarded. The kernels below add their counts to `counts` (one entry
+ * per bucket, zeroed by the caller); `bucket` maps a value to [0, counts.size()). */
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__AVX512CD__)
+#include <immintrin.h>
+#endif
+
+/* value mod k, with Lemire's multiply-based remainder instead of a division */
+struct mod_buckets
+{
+        std::uint32_t k;
+        std::uint64_t magic = UINT64_MAX / k + 1;
+
+        std::uint32_t operator()(const std::uint32_t value) const
+        {
+                const std::uint64_t low = magic * value;
+                return std::uint32_t((__uint128_t(low) * k) >> 64);
+        }
+
+        std::size_t size() const
+        {
+                return k;
+        }
+};
+
+/* The top `bits` bits of the value (1 to 32) */
+struct top_bits_buckets
+{
+        unsigned bits;
+
+        std::uint32_t operator()(const std::uint32_t value) const
+        {
+                return std::uint32_t(std::uint64_t(value) >> (32 - bits));
+        }
+
+        std::size_t size() const
+        {
+                return std::size_t(1) << bits;
+        }
+};
+
+template<typename Bucket>
+void histogram_scalar(const std::span<const std::uint32_t> data, const Bucket& bucket,
+                      const std::span<std::uint32_t> counts)
+{
+        for(const auto value : data)
+        {
+                ++counts[bucket(value)];
+        }
+}
+
+/* COPIES interleaved sub-histograms, value i going to copy i % COPIES: repeated buckets in a row
+ * hit different counters, so up to COPIES increments of a hot bucket are in flight at once. The
+ * copies of a bucket share a cache line; they are summed at the end. */
+template<std::size_t COPIES = 4, typename Bucket>
+void histogram_replicated(const std::span<const std::uint32_t> data, const Bucket& bucket,
+                          const std::span<std::uint32_t> counts)
+{
+        std::vector<std::uint32_t> sub(counts.size() * COPIES);
+
+        std::size_t i = 0;
+        for(; i + COPIES <= data.size(); i += COPIES)
+        {
+                for(std::size_t c = 0; c < COPIES; ++c)
+                {
+                        ++sub[bucket(data[i + c]) * COPIES + c];
+                }
+        }
+        for(; i < data.size(); ++i)
+        {
+                ++sub[bucket(data[i]) * COPIES];
+        }
+
+        for(std::size_t b = 0; b < counts.size(); ++b)
+        {
+                std::uint32_t sum = 0;
+                for(std::size_t c = 0; c < COPIES; ++c)
+                {
+                        sum += sub[b * COPIES + c];
+                }
+                counts[b] += sum;
+        }
+}
+
+#if defined(__AVX512CD__)
+/* 16 values per step: gather their counters, add to each lane the number of lanes with the same
+ * bucket up to and including it, scatter back. Scatters to one address are ordered by lane, so
+ * the last lane of a bucket, which carries the full increment, is the one that sticks.
+ *
+ * `vpconflictd` marks the earlier lanes with the same bucket; 31 - `vplzcntd` of that is the
+ * nearest one (-1 if none). The counts are summed along these links by pointer jumping: each
+ * round adds the count of the linked lane and links to its link, so a bucket that appears n
+ * times is done after log2(n) rounds, and conflict-free steps after none. `vpopcntd` would count
+ * the marks directly, but only Ice Lake and later have it. */
+template<typename Bucket>
+void histogram_conflict(const std::span<const std::uint32_t> data, const Bucket& bucket,
+                        const std::span<std::uint32_t> counts)
+{
+        const auto one = _mm512_set1_epi32(1);
+        const auto minus_one = _mm512_set1_epi32(-1);
+        const auto thirty_one = _mm512_set1_epi32(31);
+        auto* const base = reinterpret_cast<int*>(counts.data());
+
+        std::size_t i = 0;
+        for(; i + 16 <= data.size(); i += 16)
+        {
+                /* computed with scalar code (GCC vectorizes it for shifts) */
+                alignas(64) std::uint32_t buckets[16];
+                for(std::size_t j = 0; j < 16; ++j)
+                {
+                        buckets[j] = bucket(data[i + j]);
+                }
+
+                const auto idx = _mm512_load_si512(buckets);
+                const auto conflicts = _mm512_conflict_epi32(idx);
+                auto increments = one;
+                auto link = _mm512_sub_epi32(thirty_one, _mm512_lzcnt_epi32(conflicts));
+                auto pending = _mm512_test_epi32_mask(conflicts, conflicts);
+                while(pending != 0)
+                {
+                        const auto linked =
+                            _mm512_maskz_permutexvar_epi32(0xffff, link, increments);
+                        increments = _mm512_mask_add_epi32(increments, pending, increments, linked);
+                        link = _mm512_mask_permutexvar_epi32(link, pending, link, link);
+                        pending = _mm512_mask_cmpneq_epi32_mask(pending, link, minus_one);
+                }
+                const auto old =
+                    _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, idx, base, 4);
+                _mm512_i32scatter_epi32(base, idx, _mm512_add_epi32(old, increments), 4);
+        }
+        for(; i < data.size(); ++i)
+        {
+                ++counts[bucket(data[i])];
+        }
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+/* Iterator-predicate wrappers in the style of libstdc++'s `__gnu_cxx::__ops::_Iter_pred`, which
+ * the algorithms apply to iterators. `_Iter_pred` converts the result to `bool`; keeping the
+ * predicate's own return type instead (`_Iter_pred_auto`) is what lets GCC vectorize the loops,
+ * see bool_returned_prevents_vectorization.md. */
+
+#include <utility> /* _GLIBCXX_MOVE, _GLIBCXX20_CONSTEXPR: libstdc++ only, like the wrappers */
+
+template<typename _Predicate>
+struct _Iter_pred_auto
+{
+        _Predicate _M_pred;
+
+        _GLIBCXX20_CONSTEXPR
+        explicit _Iter_pred_auto(_Predicate __pred)
+            : _M_pred(_GLIBCXX_MOVE(__pred))
+        {
+        }
+
+        // RETURNS THE ORIGINAL TYPE OF THE LAMBDA
+        template<typename _Iterator>
+        _GLIBCXX20_CONSTEXPR auto operator()(_Iterator __it) const
+        {
+                return _M_pred(*__it);
+        }
+};
+
+template<typename _Predicate>
+struct _Iter_pred_bool
+{
+        _Predicate _M_pred;
+
+        _GLIBCXX20_CONSTEXPR
+        explicit _Iter_pred_bool(_Predicate __pred)
+            : _M_pred(_GLIBCXX_MOVE(__pred))
+        {
+        }
+
+        // IGNORES THE ORIGINAL TYPE RETURNED BY THE LAMBDA
+        template<typename _Iterator>
+        _GLIBCXX20_CONSTEXPR bool operator()(_Iterator __it) const
+        {
+                return bool(_M_pred(*__it));
+        }
+};
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "narrow_reduce.hpp"
+
+static constexpr std::size_t SIZE = 1 << 22;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+template<typename T>
+static const dataset<T>& test_data()
+{
+        static const auto data = uniform_dataset<T>(SIZE, SEED);
+        return data;
+}
+
+/* The usual way of not overflowing: a 64-bit accumulator for every element */
+template<typename T>
+using total_type = std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>;
+
+template<typename T>
+static void finish(benchmark::State& state)
+{
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE * sizeof(T)));
+}
+
+template<typename T>
+static void std_accumulate(benchmark::State& state)
+{
+        const auto& data = test_data<T>();
+
+        for(auto _ : state)
+        {
+                const auto tmp = std::accumulate(data.begin(), data.end(), total_type<T>{0});
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish<T>(state);
+}
+
+template<typename T>
+static void std_reduce(benchmark::State& state)
+{
+        const auto& data = test_data<T>();
+
+        for(auto _ : state)
+        {
+                const auto tmp = std::reduce(data.begin(), data.end(), total_type<T>{0});
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish<T>(state);
+}
+
+template<typename T>
+static void blocked_narrow_sum(benchmark::State& state)
+{
+        const auto& data = test_data<T>();
+
+        for(auto _ : state)
+        {
+                const auto tmp = narrow_sum<T>(data);
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish<T>(state);
+}
+
+template<typename T>
+static void std_minmax_element(benchmark::State& state)
+{
+        const auto& data = test_data<T>();
+
+        for(auto _ : state)
+        {
+                const auto tmp = std::minmax_element(data.begin(), data.end());
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish<T>(state);
+}
+
+template<typename T>
+static void single_pass_minmax(benchmark::State& state)
+{
+        const auto& data = test_data<T>();
+
+        for(auto _ : state)
+        {
+                const auto tmp = narrow_minmax<T>(data);
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish<T>(state);
+}
+
+#define NARROW_REDUCE_BENCHMARKS(T)                                                                \
+        BENCHMARK_TEMPLATE(std_accumulate, T);                                                     \
+        BENCHMARK_TEMPLATE(std_reduce, T);                                                         \
+        BENCHMARK_TEMPLATE(blocked_narrow_sum, T);                                                 \
+        BENCHMARK_TEMPLATE(std_minmax_element, T);                                                 \
+        BENCHMARK_TEMPLATE(single_pass_minmax, T)
+
+NARROW_REDUCE_BENCHMARKS(std::uint8_t);
+NARROW_REDUCE_BENCHMARKS(std::int8_t);
+NARROW_REDUCE_BENCHMARKS(std::uint16_t);
+NARROW_REDUCE_BENCHMARKS(std::int16_t);
+NARROW_REDUCE_BENCHMARKS(std::uint32_t);
+NARROW_REDUCE_BENCHMARKS(std::int32_t);
+NARROW_REDUCE_BENCHMARKS(std::uint64_t);
+NARROW_REDUCE_BENCHMARKS(std::int64_t);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,188 @@
+#pragma once
+
+/* Reductions that keep the vector lanes as narrow as the data allows, after
+ * simd_prefers_32bit_data.md: summing uint8 straight into a uint64 makes GCC widen every element
+ * through a chain of `vpmovzx`, with 8 lanes of useful work per 512-bit vector instead of 64. Sums
+ * go into the next wider type over blocks short enough that it can't overflow, and only the block
+ * results are widened to 64 bits. Byte sums use `vpsadbw`, which adds 8 bytes into a 64-bit lane
+ * in one instruction. Min and max, of the elements or of a transform of them, need no widening
+ * at all. */
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* The next wider integer type with the same signedness (64-bit types stay as they are) */
+template<typename R>
+using widened_t = std::conditional_t<
+    sizeof(R) == 1, std::conditional_t<std::is_signed_v<R>, std::int16_t, std::uint16_t>,
+    std::conditional_t<
+        sizeof(R) == 2, std::conditional_t<std::is_signed_v<R>, std::int32_t, std::uint32_t>,
+        std::conditional_t<std::is_signed_v<R>, std::int64_t, std::uint64_t>>>;
+
+/* How many values of type R a widened_t<R> can sum without overflowing, as a power of two */
+template<typename R>
+constexpr std::size_t narrow_block_size()
+{
+        using W = widened_t<R>;
+        if constexpr(sizeof(W) == sizeof(R))
+        {
+                return std::numeric_limits<std::size_t>::max();
+        }
+        else
+        {
+                auto n = std::size_t(std::numeric_limits<W>::max() / std::numeric_limits<R>::max());
+                if constexpr(std::is_signed_v<R>)
+                {
+                        n = std::min(n, std::size_t(std::numeric_limits<W>::min() /
+                                                    std::numeric_limits<R>::min()));
+                }
+                return std::bit_floor(n);
+        }
+}
+
+/* Sum of `transform(el)`, where `transform` returns an integer type R: R values are added in
+ * widened_t<R> over blocks of narrow_block_size<R>() elements, and the block sums in 64 bits.
+ * The result is exact unless it overflows 64 bits. */
+template<typename T, typename Transform>
+auto narrow_transform_sum(const std::span<const T> data, const Transform transform)
+{
+        using R = std::remove_cvref_t<decltype(transform(data[0]))>;
+        static_assert(std::is_integral_v<R> && !std::is_same_v<R, bool>,
+                      "transform must return a (non-bool) integer type");
+        using W = widened_t<R>;
+        using total_type = std::conditional_t<std::is_signed_v<R>, std::int64_t, std::uint64_t>;
+        constexpr auto BLOCK = narrow_block_size<R>();
+
+        total_type total = 0;
+        for(std::size_t start = 0; start < data.size();)
+        {
+                const auto end = data.size() - start > BLOCK ? start + BLOCK : data.size();
+                W partial = 0;
+                for(std::size_t i = start; i < end; ++i)
+                {
+                        partial = W(partial + transform(data[i]));
+                }
+                total += partial;
+                start = end;
+        }
+        return total;
+}
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+/* Sum of bytes with `vpsadbw` (absolute differences against zero, summed per 8 bytes) */
+inline std::uint64_t sad_byte_sum(const std::uint8_t* data, const std::size_t size,
+                                  const std::uint8_t flip = 0)
+{
+        std::size_t i = 0;
+        std::uint64_t total = 0;
+
+#if defined(__AVX512BW__)
+        const auto zero = _mm512_setzero_si512();
+        const auto flip_mask = _mm512_set1_epi8(char(flip));
+        auto acc = _mm512_setzero_si512();
+        for(; i + 64 <= size; i += 64)
+        {
+                const auto v = _mm512_xor_si512(_mm512_loadu_si512(data + i), flip_mask);
+                acc = _mm512_add_epi64(acc, _mm512_sad_epu8(v, zero));
+        }
+        alignas(64) std::uint64_t lanes[8];
+        _mm512_store_si512(lanes, acc);
+        for(const auto lane : lanes)
+        {
+                total += lane;
+        }
+#else
+        const auto zero = _mm256_setzero_si256();
+        const auto flip_mask = _mm256_set1_epi8(char(flip));
+        auto acc = _mm256_setzero_si256();
+        for(; i + 32 <= size; i += 32)
+        {
+                const auto v =
+                    _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(data + i)), flip_mask);
+                acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+        }
+        const auto halves =
+            _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        total = std::uint64_t(_mm_cvtsi128_si64(halves)) +
+                std::uint64_t(_mm_extract_epi64(halves, 1));
+#endif
+
+        for(; i < size; ++i)
+        {
+                total += std::uint8_t(data[i] ^ flip);
+        }
+        return total;
+}
+#endif
+
+/* Sum of the elements, as a 64-bit integer of the same signedness */
+template<typename T>
+auto narrow_sum(const std::span<const T> data)
+{
+        static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>);
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+        if constexpr(sizeof(T) == 1 && std::is_unsigned_v<T>)
+        {
+                return sad_byte_sum(reinterpret_cast<const std::uint8_t*>(data.data()),
+                                    data.size());
+        }
+        else if constexpr(sizeof(T) == 1)
+        {
+                /* x + 128 is unsigned: sum that, then take 128 off per element */
+                return std::int64_t(sad_byte_sum(
+                           reinterpret_cast<const std::uint8_t*>(data.data()), data.size(), 0x80)) -
+                       std::int64_t(128 * data.size());
+        }
+        else
+#endif
+        {
+                return narrow_transform_sum(data,
+                                            [](const T el)
+                                            {
+                                                    return el;
+                                            });
+        }
+}
+
+/* Smallest and largest `transform(el)` over a non-empty range, where `transform` returns an
+ * integer type R, in one pass over R-wide lanes. Unlike the sum there is nothing to widen or to
+ * split into blocks: the min and max of R values are R values. */
+template<typename T, typename Transform>
+auto narrow_transform_minmax(const std::span<const T> data, const Transform transform)
+{
+        using R = std::remove_cvref_t<decltype(transform(data[0]))>;
+        static_assert(std::is_integral_v<R> && !std::is_same_v<R, bool>,
+                      "transform must return a (non-bool) integer type");
+
+        R lo = transform(data[0]);
+        R hi = lo;
+        for(const T& el : data)
+        {
+                const R value = transform(el);
+                lo = value < lo ? value : lo;
+                hi = value > hi ? value : hi;
+        }
+        return std::pair<R, R>(lo, hi);
+}
+
+/* Smallest and largest element of a non-empty range */
+template<typename T>
+std::pair<T, T> narrow_minmax(const std::span<const T> data)
+{
+        return narrow_transform_minmax(data,
+                                       [](const T el)
+                                       {
+                                               return el;
+                                       });
+}
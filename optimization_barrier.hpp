@@ -0,0 +1,53 @@
+#pragma once
+
+/* Optimization barriers for experiments that must keep loads and stores in the generated code at
+ * -O3, without switching the optimizer off for the whole function. Only `relaxed_store` emits an
+ * instruction (the store itself); the others constrain the compiler and nothing else. GNU
+ * extended asm, so GCC and Clang only. */
+
+#include <atomic>
+
+/* Every value in memory may be read and written here: pending stores are issued before the
+ * barrier, and values are reloaded after it. */
+inline void clobber_memory()
+{
+        asm volatile("" : : : "memory");
+}
+
+/* `value` is considered read and modified at this point, so its computation cannot be removed
+ * and later uses cannot be folded with earlier ones. */
+template<typename T>
+inline void do_not_optimize(T& value)
+{
+#if defined(__clang__)
+        asm volatile("" : "+r,m"(value) : : "memory");
+#else
+        asm volatile("" : "+m,r"(value) : : "memory");
+#endif
+}
+
+template<typename T>
+inline void do_not_optimize(const T& value)
+{
+        asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/* `ptr` escapes: the object it points to may be read or written by unknown code from now on. */
+inline void escape(const void* ptr)
+{
+        asm volatile("" : : "g"(ptr) : "memory");
+}
+
+/* A store the compiler must not drop or merge with other stores to `obj`; on x86 a plain `mov`
+ * without a `lock` prefix or fence. */
+template<typename T>
+inline void relaxed_store(T& obj, const T value)
+{
+        std::atomic_ref<T>(obj).store(value, std::memory_order_relaxed);
+}
+
+template<typename T>
+inline T relaxed_load(T& obj)
+{
+        return std::atomic_ref<T>(obj).load(std::memory_order_relaxed);
+}
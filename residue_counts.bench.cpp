@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "histogram.hpp"
+#include "residue_counts.hpp"
+
+static constexpr std::size_t SIZE = 1 << 22;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+static const auto global_vec = uniform_dataset<std::uint32_t>(SIZE, SEED);
+
+template<unsigned K>
+static void finish(benchmark::State& state)
+{
+        state.SetBytesProcessed(int64_t(state.iterations()) *
+                                int64_t(SIZE * sizeof(std::uint32_t)));
+        state.SetLabel("classes:" + std::to_string(1u << K));
+}
+
+/* One vectorized count per class, with a 32-bit count as in simd_prefers_32bit_data.md */
+template<unsigned K>
+static void count_per_class(benchmark::State& state)
+{
+        for(auto _ : state)
+        {
+                std::array<std::uint32_t, 1u << K> counts;
+                for(std::uint32_t cls = 0; cls < counts.size(); ++cls)
+                {
+                        std::uint32_t n = 0;
+                        for(const auto value : global_vec)
+                        {
+                                n += (value & ((1u << K) - 1)) == cls;
+                        }
+                        counts[cls] = n;
+                }
+                benchmark::DoNotOptimize(counts);
+        }
+
+        finish<K>(state);
+}
+
+template<unsigned K>
+static void scalar_histogram(benchmark::State& state)
+{
+        for(auto _ : state)
+        {
+                std::array<std::uint32_t, 1u << K> counts{};
+                histogram_scalar(std::span<const std::uint32_t>(global_vec), low_bits_buckets{K},
+                                 std::span<std::uint32_t>(counts));
+                benchmark::DoNotOptimize(counts);
+        }
+
+        finish<K>(state);
+}
+
+template<unsigned K>
+static void one_pass(benchmark::State& state)
+{
+        for(auto _ : state)
+        {
+                const auto counts = residue_counts<K>(global_vec);
+                benchmark::DoNotOptimize(counts);
+        }
+
+        finish<K>(state);
+}
+
+#define RESIDUE_BENCHMARKS(K)                                                                      \
+        BENCHMARK_TEMPLATE(count_per_class, K);                                                    \
+        BENCHMARK_TEMPLATE(scalar_histogram, K);                                                   \
+        BENCHMARK_TEMPLATE(one_pass, K)
+
+RESIDUE_BENCHMARKS(1);
+RESIDUE_BENCHMARKS(2);
+RESIDUE_BENCHMARKS(3);
+RESIDUE_BENCHMARKS(4);
+
+BENCHMARK_MAIN();
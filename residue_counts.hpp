@@ -0,0 +1,177 @@
+#pragma once
+
+/* How many values fall in each residue class mod 2^K (K from 1 to 4), in one pass instead of one
+ * count_if per class; `is_even` counting is K = 1. The low bits of 32 (AVX2) or 64 (AVX-512)
+ * values are packed into one byte vector and compared against every class except the last one,
+ * which gets what is left. Each lane has an 8-bit counter per class, so the loop runs in rounds
+ * of at most 255 steps; at the end of a round the byte counters are summed with `vpsadbw` and
+ * cleared. The tail and targets without AVX2 go through histogram.hpp.
+ *
+ * K stops at 4: with 16 classes the counters fill the registers, and every further class costs a
+ * compare per vector, which loses to histogram_replicated from 64 classes on. Count more classes
+ * with histogram_replicated and low_bits_buckets. */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "histogram.hpp"
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* The low `bits` bits of the value (0 to 8) */
+struct low_bits_buckets
+{
+        unsigned bits;
+
+        std::uint32_t operator()(const std::uint32_t value) const
+        {
+                return value & ((1u << bits) - 1);
+        }
+
+        std::size_t size() const
+        {
+                return std::size_t(1) << bits;
+        }
+};
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+/* Counts the longest prefix of `data` that fills whole steps into `counts`; returns its length */
+template<std::size_t CLASSES>
+std::size_t residue_counts_simd(const std::span<const std::uint32_t> data,
+                                std::array<std::uint64_t, CLASSES>& counts)
+{
+        static_assert(CLASSES >= 2 && CLASSES <= 16);
+
+#if defined(__AVX512BW__)
+        using vec = __m512i;
+        constexpr std::size_t STEP = 64;
+        const auto zero = _mm512_setzero_si512();
+        const auto low = _mm512_set1_epi32(int(CLASSES - 1));
+        const auto load = [&](const std::uint32_t* ptr)
+        {
+                return _mm512_and_si512(_mm512_loadu_si512(ptr), low);
+        };
+        /* the packs work within 128-bit lanes; the order of the bytes doesn't matter here */
+        const auto pack = [](const vec a, const vec b, const vec c, const vec d)
+        {
+                return _mm512_packus_epi16(_mm512_packus_epi32(a, b), _mm512_packus_epi32(c, d));
+        };
+        const auto count_equal = [](const vec acc, const vec residues, const std::size_t cls)
+        {
+                const auto eq = _mm512_cmpeq_epi8_mask(residues, _mm512_set1_epi8(char(cls)));
+                return _mm512_mask_sub_epi8(acc, eq, acc, _mm512_set1_epi8(-1));
+        };
+        const auto byte_sum = [&](const vec acc)
+        {
+                alignas(64) std::uint64_t lanes[8];
+                _mm512_store_si512(lanes, _mm512_sad_epu8(acc, zero));
+                std::uint64_t sum = 0;
+                for(const auto lane : lanes)
+                {
+                        sum += lane;
+                }
+                return sum;
+        };
+#else
+        using vec = __m256i;
+        constexpr std::size_t STEP = 32;
+        const auto zero = _mm256_setzero_si256();
+        const auto low = _mm256_set1_epi32(int(CLASSES - 1));
+        const auto load = [&](const std::uint32_t* ptr)
+        {
+                return _mm256_and_si256(_mm256_loadu_si256((const __m256i*)ptr), low);
+        };
+        const auto pack = [](const vec a, const vec b, const vec c, const vec d)
+        {
+                return _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+        };
+        const auto count_equal = [](const vec acc, const vec residues, const std::size_t cls)
+        {
+                /* the comparison yields -1 for a match */
+                return _mm256_sub_epi8(acc,
+                                       _mm256_cmpeq_epi8(residues, _mm256_set1_epi8(char(cls))));
+        };
+        const auto byte_sum = [&](const vec acc)
+        {
+                alignas(32) std::uint64_t lanes[4];
+                _mm256_store_si256((__m256i*)lanes, _mm256_sad_epu8(acc, zero));
+                return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        };
+#endif
+
+        constexpr std::size_t QUARTER = STEP / 4;
+        std::size_t i = 0;
+        while(data.size() - i >= STEP)
+        {
+                vec acc[CLASSES - 1];
+                for(auto& a : acc)
+                {
+                        a = zero;
+                }
+
+                const auto steps = std::min<std::size_t>(255, (data.size() - i) / STEP);
+                for(std::size_t s = 0; s < steps; ++s, i += STEP)
+                {
+                        const auto* ptr = data.data() + i;
+                        const auto residues =
+                            pack(load(ptr), load(ptr + QUARTER), load(ptr + 2 * QUARTER),
+                                 load(ptr + 3 * QUARTER));
+                        for(std::size_t cls = 0; cls + 1 < CLASSES; ++cls)
+                        {
+                                acc[cls] = count_equal(acc[cls], residues, cls);
+                        }
+                }
+
+                for(std::size_t cls = 0; cls + 1 < CLASSES; ++cls)
+                {
+                        counts[cls] += byte_sum(acc[cls]);
+                }
+        }
+
+        std::uint64_t others = 0;
+        for(std::size_t cls = 0; cls + 1 < CLASSES; ++cls)
+        {
+                others += counts[cls];
+        }
+        counts[CLASSES - 1] = i - others;
+        return i;
+}
+#endif
+
+template<unsigned K>
+std::array<std::uint64_t, std::size_t(1) << K>
+residue_counts(const std::span<const std::uint32_t> data)
+{
+        static_assert(K >= 1 && K <= 4,
+                      "residue_counts covers K <= 4; for more classes use histogram_replicated "
+                      "with low_bits_buckets");
+        constexpr std::size_t CLASSES = std::size_t(1) << K;
+
+        std::array<std::uint64_t, CLASSES> counts{};
+        std::size_t done = 0;
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+        done = residue_counts_simd(data, counts);
+#endif
+
+        /* histogram counters are 32 bits wide */
+        std::array<std::uint32_t, CLASSES> partial;
+        while(done < data.size())
+        {
+                const auto n = std::min<std::size_t>(data.size() - done, std::size_t(1) << 31);
+                partial.fill(0);
+                histogram_replicated(data.subspan(done, n), low_bits_buckets{K},
+                                     std::span<std::uint32_t>(partial));
+                for(std::size_t cls = 0; cls < CLASSES; ++cls)
+                {
+                        counts[cls] += partial[cls];
+                }
+                done += n;
+        }
+        return counts;
+}
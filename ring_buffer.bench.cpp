@@ -0,0 +1,229 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include <sched.h>
+
+#include "bench_context.hpp"
+#include "ring_buffer.hpp"
+#include "thread_pool.hpp"
+
+using element_type = std::uint64_t;
+
+static constexpr std::size_t CAPACITY = 1 << 10;
+
+static constexpr std::size_t ITEMS = 1 << 14; /* per producer and benchmark iteration */
+
+static constexpr std::size_t BATCH = 64;
+
+/* Baseline: std::deque behind a mutex, with the ring interface */
+template<typename T>
+class locked_deque
+{
+public:
+        explicit locked_deque(const std::size_t capacity)
+            : capacity_(capacity)
+        {
+        }
+
+        bool try_push(const T& value)
+        {
+                std::lock_guard lock(mutex_);
+                if(items_.size() == capacity_)
+                {
+                        return false;
+                }
+                items_.push_back(value);
+                return true;
+        }
+
+        bool try_pop(T& out)
+        {
+                std::lock_guard lock(mutex_);
+                if(items_.empty())
+                {
+                        return false;
+                }
+                out = items_.front();
+                items_.pop_front();
+                return true;
+        }
+
+private:
+        std::mutex mutex_;
+        std::deque<T> items_;
+        std::size_t capacity_;
+};
+
+/* Retries `op` until it succeeds; yields now and then so that the benchmark also finishes when
+ * there are fewer CPUs than threads */
+template<typename Op>
+static void retry(const Op& op)
+{
+        for(unsigned i = 0; !op(); ++i)
+        {
+                cpu_relax();
+                if(i % 256 == 255)
+                {
+                        ::sched_yield();
+                }
+        }
+}
+
+/* Even threads produce, odd threads consume ITEMS elements per iteration each */
+template<typename Queue>
+static void throughput(benchmark::State& state)
+{
+        static Queue queue(CAPACITY);
+        const bool producer = state.thread_index() % 2 == 0;
+
+        for(auto _ : state)
+        {
+                for(std::size_t i = 0; i < ITEMS; ++i)
+                {
+                        if(producer)
+                        {
+                                retry(
+                                    [&]
+                                    {
+                                            return queue.try_push(element_type(i));
+                                    });
+                        }
+                        else
+                        {
+                                element_type value;
+                                retry(
+                                    [&]
+                                    {
+                                            return queue.try_pop(value);
+                                    });
+                                benchmark::DoNotOptimize(value);
+                        }
+                }
+        }
+
+        /* counted on the consumers only: each element once */
+        state.counters["items_per_second"] = benchmark::Counter(
+            producer ? 0.0 : double(state.iterations() * ITEMS), benchmark::Counter::kIsRate);
+}
+
+template<typename Ring>
+static std::size_t push_some(Ring& ring, const element_type* values, const std::size_t n)
+{
+        if constexpr(requires { ring.try_push_n(values, n); })
+        {
+                return ring.try_push_n(values, n);
+        }
+        else
+        {
+                return ring.push_batch(values, n);
+        }
+}
+
+template<typename Ring>
+static std::size_t pop_some(Ring& ring, element_type* out, const std::size_t max)
+{
+        if constexpr(requires { ring.try_pop_n(out, max); })
+        {
+                return ring.try_pop_n(out, max);
+        }
+        else
+        {
+                return ring.pop_batch(out, max);
+        }
+}
+
+/* Rings moving up to BATCH elements per index update (one CAS for the MPMC ring); even threads
+ * produce, odd threads consume */
+template<typename Ring>
+static void batch_throughput(benchmark::State& state)
+{
+        static Ring ring(CAPACITY);
+        const bool producer = state.thread_index() % 2 == 0;
+        element_type buffer[BATCH] = {};
+
+        for(auto _ : state)
+        {
+                for(std::size_t done = 0; done < ITEMS;)
+                {
+                        const auto want = std::min(BATCH, ITEMS - done);
+                        std::size_t n = 0;
+                        retry(
+                            [&]
+                            {
+                                    n = producer ? push_some(ring, buffer, want)
+                                                 : pop_some(ring, buffer, want);
+                                    return n != 0;
+                            });
+                        done += n;
+                }
+                benchmark::DoNotOptimize(buffer);
+        }
+
+        state.counters["items_per_second"] = benchmark::Counter(
+            producer ? 0.0 : double(state.iterations() * ITEMS), benchmark::Counter::kIsRate);
+}
+
+/* Round trip: thread 0 sends a value through one queue and waits for thread 1 to send it back
+ * through another; one iteration is one round trip */
+template<typename Queue>
+static void ping_pong(benchmark::State& state)
+{
+        static Queue ping(CAPACITY);
+        static Queue pong(CAPACITY);
+        const bool initiator = state.thread_index() == 0;
+        element_type value = 0;
+
+        for(auto _ : state)
+        {
+                auto& in = initiator ? pong : ping;
+                auto& out = initiator ? ping : pong;
+                if(initiator)
+                {
+                        retry(
+                            [&]
+                            {
+                                    return out.try_push(value);
+                            });
+                }
+                retry(
+                    [&]
+                    {
+                            return in.try_pop(value);
+                    });
+                if(!initiator)
+                {
+                        retry(
+                            [&]
+                            {
+                                    return out.try_push(value + 1);
+                            });
+                }
+        }
+        benchmark::DoNotOptimize(value);
+}
+
+BENCHMARK_TEMPLATE(throughput, spsc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(throughput, unpadded_spsc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(throughput, mpmc_ring<element_type>)->Threads(2)->Threads(4)->UseRealTime();
+BENCHMARK_TEMPLATE(throughput, unpadded_mpmc_ring<element_type>)
+    ->Threads(2)
+    ->Threads(4)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(throughput, locked_deque<element_type>)->Threads(2)->Threads(4)->UseRealTime();
+
+BENCHMARK_TEMPLATE(batch_throughput, spsc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(batch_throughput, unpadded_spsc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(batch_throughput, mpmc_ring<element_type>)
+    ->Threads(2)
+    ->Threads(4)
+    ->UseRealTime();
+
+BENCHMARK_TEMPLATE(ping_pong, spsc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(ping_pong, unpadded_spsc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(ping_pong, mpmc_ring<element_type>)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(ping_pong, locked_deque<element_type>)->Threads(2)->UseRealTime();
+
+BENCHMARK_MAIN();
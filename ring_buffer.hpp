@@ -0,0 +1,312 @@
+#pragma once
+
+/* Bounded lock-free ring buffers. The producer and consumer indices live on separate padded
+ * blocks (the false_sharing.cpp lesson): with `ALIGN` set to the index size instead, both share a
+ * line, which is what the unpadded variants are for. Capacities are rounded up to a power of
+ * two. */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "cache_padded.hpp"
+
+/* Single producer, single consumer. Each side keeps a private copy of the other side's index and
+ * only reloads it (a cache miss when the other side is active) when the copy says the ring is
+ * full or empty. */
+template<typename T, std::size_t ALIGN = destructive_interference_size>
+class spsc_ring
+{
+public:
+        explicit spsc_ring(const std::size_t capacity)
+            : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+            , slots_(std::make_unique<T[]>(mask_ + 1))
+        {
+        }
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        std::size_t capacity() const
+        {
+                return mask_ + 1;
+        }
+
+        /* Producer only */
+        bool try_push(const T& value)
+        {
+                return push_batch(&value, 1) == 1;
+        }
+
+        /* Consumer only */
+        bool try_pop(T& out)
+        {
+                return pop_batch(&out, 1) == 1;
+        }
+
+        /* Producer only. Pushes the first min(n, free slots) values of `values`, publishes them
+         * with one store and returns how many were pushed. */
+        std::size_t push_batch(const T* values, std::size_t n)
+        {
+                const auto tail = producer_.tail.load(std::memory_order_relaxed);
+                if(capacity() - (tail - producer_.cached_head) < n)
+                {
+                        producer_.cached_head = consumer_.head.load(std::memory_order_acquire);
+                }
+                n = std::min(n, capacity() - (tail - producer_.cached_head));
+
+                for(std::size_t i = 0; i < n; ++i)
+                {
+                        slots_[(tail + i) & mask_] = values[i];
+                }
+                producer_.tail.store(tail + n, std::memory_order_release);
+                return n;
+        }
+
+        /* Consumer only. Pops up to `max` values into `out` and returns how many were popped. */
+        std::size_t pop_batch(T* out, const std::size_t max)
+        {
+                const auto head = consumer_.head.load(std::memory_order_relaxed);
+                if(consumer_.cached_tail - head < max)
+                {
+                        consumer_.cached_tail = producer_.tail.load(std::memory_order_acquire);
+                }
+                const auto n = std::min(max, consumer_.cached_tail - head);
+
+                for(std::size_t i = 0; i < n; ++i)
+                {
+                        out[i] = slots_[(head + i) & mask_];
+                }
+                consumer_.head.store(head + n, std::memory_order_release);
+                return n;
+        }
+
+private:
+        /* read-only after construction, shared by both sides */
+        std::size_t mask_;
+        std::unique_ptr<T[]> slots_;
+
+        struct alignas(ALIGN) producer_side
+        {
+                std::atomic<std::size_t> tail{0};
+                std::size_t cached_head = 0;
+        };
+
+        struct alignas(ALIGN) consumer_side
+        {
+                std::atomic<std::size_t> head{0};
+                std::size_t cached_tail = 0;
+        };
+
+        producer_side producer_;
+        consumer_side consumer_;
+};
+
+/* SPSC ring with both indices on one cache line, for comparison */
+template<typename T>
+using unpadded_spsc_ring = spsc_ring<T, alignof(std::size_t)>;
+
+/* Bounded multi-producer multi-consumer queue (Dmitry Vyukov's design): every cell carries a
+ * sequence number that tells producers and consumers whether it is free for the current lap, so
+ * the only shared writes are one CAS on the enqueue or dequeue index per operation. The batched
+ * operations check the sequence numbers of consecutive cells and claim all the ready ones with a
+ * single CAS. */
+template<typename T, std::size_t ALIGN = destructive_interference_size>
+class mpmc_ring
+{
+public:
+        explicit mpmc_ring(const std::size_t capacity)
+            : mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+            , cells_(std::make_unique<cell[]>(mask_ + 1))
+        {
+                for(std::size_t i = 0; i <= mask_; ++i)
+                {
+                        cells_[i].seq.store(i, std::memory_order_relaxed);
+                }
+        }
+
+        mpmc_ring(const mpmc_ring&) = delete;
+        mpmc_ring& operator=(const mpmc_ring&) = delete;
+
+        std::size_t capacity() const
+        {
+                return mask_ + 1;
+        }
+
+        bool try_push(const T& value)
+        {
+                auto pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+                cell* c;
+                for(;;)
+                {
+                        c = &cells_[pos & mask_];
+                        const auto seq = c->seq.load(std::memory_order_acquire);
+                        const auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+                        if(diff == 0)
+                        {
+                                if(enqueue_pos_.value.compare_exchange_weak(
+                                       pos, pos + 1, std::memory_order_relaxed))
+                                {
+                                        break;
+                                }
+                        }
+                        else if(diff < 0)
+                        {
+                                return false; /* full */
+                        }
+                        else
+                        {
+                                pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+                        }
+                }
+
+                c->value = value;
+                c->seq.store(pos + 1, std::memory_order_release);
+                return true;
+        }
+
+        bool try_pop(T& out)
+        {
+                auto pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+                cell* c;
+                for(;;)
+                {
+                        c = &cells_[pos & mask_];
+                        const auto seq = c->seq.load(std::memory_order_acquire);
+                        const auto diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+                        if(diff == 0)
+                        {
+                                if(dequeue_pos_.value.compare_exchange_weak(
+                                       pos, pos + 1, std::memory_order_relaxed))
+                                {
+                                        break;
+                                }
+                        }
+                        else if(diff < 0)
+                        {
+                                return false; /* empty */
+                        }
+                        else
+                        {
+                                pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+                        }
+                }
+
+                out = c->value;
+                c->seq.store(pos + mask_ + 1, std::memory_order_release);
+                return true;
+        }
+
+        /* Pushes the longest prefix of values[0, n) that fits in consecutive free cells; returns
+         * its length (0 if the ring is full) */
+        std::size_t try_push_n(const T* values, const std::size_t n)
+        {
+                auto pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+                std::size_t k;
+                for(;;)
+                {
+                        /* cell pos + k is free for this lap if its sequence number is pos + k */
+                        k = ready_cells(pos, n, 0);
+                        if(k != 0)
+                        {
+                                if(enqueue_pos_.value.compare_exchange_weak(
+                                       pos, pos + k, std::memory_order_relaxed))
+                                {
+                                        break;
+                                }
+                        }
+                        else if(lap_diff(pos, 0) < 0)
+                        {
+                                return 0; /* full */
+                        }
+                        else
+                        {
+                                pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+                        }
+                }
+
+                for(std::size_t i = 0; i < k; ++i)
+                {
+                        auto& c = cells_[(pos + i) & mask_];
+                        c.value = values[i];
+                        c.seq.store(pos + i + 1, std::memory_order_release);
+                }
+                return k;
+        }
+
+        /* Pops up to `max` elements from consecutive filled cells into `out`; returns how many
+         * (0 if the ring is empty) */
+        std::size_t try_pop_n(T* out, const std::size_t max)
+        {
+                auto pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+                std::size_t k;
+                for(;;)
+                {
+                        k = ready_cells(pos, max, 1);
+                        if(k != 0)
+                        {
+                                if(dequeue_pos_.value.compare_exchange_weak(
+                                       pos, pos + k, std::memory_order_relaxed))
+                                {
+                                        break;
+                                }
+                        }
+                        else if(lap_diff(pos, 1) < 0)
+                        {
+                                return 0; /* empty */
+                        }
+                        else
+                        {
+                                pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+                        }
+                }
+
+                for(std::size_t i = 0; i < k; ++i)
+                {
+                        auto& c = cells_[(pos + i) & mask_];
+                        out[i] = c.value;
+                        c.seq.store(pos + i + mask_ + 1, std::memory_order_release);
+                }
+                return k;
+        }
+
+private:
+        struct cell
+        {
+                std::atomic<std::size_t> seq;
+                T value;
+        };
+
+        std::size_t mask_;
+        std::unique_ptr<cell[]> cells_;
+
+        cache_padded<std::atomic<std::size_t>, ALIGN> enqueue_pos_;
+        cache_padded<std::atomic<std::size_t>, ALIGN> dequeue_pos_;
+
+        /* Sequence number of the cell for `pos`, minus the one it has when ready: 0 for producers
+         * (`filled` = 0) or consumers (`filled` = 1) of this lap */
+        std::intptr_t lap_diff(const std::size_t pos, const std::size_t filled) const
+        {
+                const auto seq = cells_[pos & mask_].seq.load(std::memory_order_acquire);
+                return std::intptr_t(seq) - std::intptr_t(pos + filled);
+        }
+
+        /* How many of the cells for pos, pos + 1, ... (at most n) are ready in a row; never more
+         * than the capacity, since the cell for pos + capacity is the one for pos */
+        std::size_t ready_cells(const std::size_t pos, const std::size_t n,
+                                const std::size_t filled) const
+        {
+                std::size_t k = 0;
+                while(k < n && lap_diff(pos + k, filled) == 0)
+                {
+                        ++k;
+                }
+                return k;
+        }
+};
+
+template<typename T>
+using unpadded_mpmc_ring = mpmc_ring<T, alignof(std::size_t)>;
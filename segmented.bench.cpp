@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "segmented.hpp"
+
+using element_type = std::uint32_t;
+
+static constexpr std::size_t SIZE = 1 << 20;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+static const auto global_vec = uniform_dataset<element_type>(SIZE, SEED);
+
+static const std::vector<element_type> test_vec(global_vec.begin(), global_vec.end());
+static const std::deque<element_type> test_deque(global_vec.begin(), global_vec.end());
+static const chunked_buffer<element_type> test_chunked(global_vec.begin(), global_vec.end());
+
+/* returns element_type, not bool, so that the contiguous loops vectorize */
+static constexpr auto is_even = [](const element_type el) -> element_type
+{
+        return el % 2 == 0;
+};
+
+template<typename Container, typename Count>
+static void run(benchmark::State& state, const Container& container, const Count& count)
+{
+        for(auto _ : state)
+        {
+                const auto tmp = count(container.begin(), container.end());
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE * sizeof(element_type)));
+}
+
+static constexpr auto std_count = [](const auto first, const auto last)
+{
+        return std::count_if(first, last, is_even);
+};
+
+static constexpr auto segment_count = [](const auto first, const auto last)
+{
+        return segmented_count_if(first, last, is_even);
+};
+
+static void vector_std_count_if(benchmark::State& state)
+{
+        run(state, test_vec, std_count);
+}
+
+static void vector_segmented(benchmark::State& state)
+{
+        run(state, test_vec, segment_count);
+}
+
+static void deque_std_count_if(benchmark::State& state)
+{
+        run(state, test_deque, std_count);
+}
+
+static void deque_segmented(benchmark::State& state)
+{
+        run(state, test_deque, segment_count);
+}
+
+static void chunked_std_count_if(benchmark::State& state)
+{
+        run(state, test_chunked, std_count);
+}
+
+static void chunked_segmented(benchmark::State& state)
+{
+        run(state, test_chunked, segment_count);
+}
+
+BENCHMARK(vector_std_count_if);
+BENCHMARK(vector_segmented);
+BENCHMARK(deque_std_count_if);
+BENCHMARK(deque_segmented);
+BENCHMARK(chunked_std_count_if);
+BENCHMARK(chunked_segmented);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,295 @@
+#pragma once
+
+/* Segmented iterators (Austern, "Segmented Iterators and Hierarchical Algorithms"): containers
+ * like std::deque store their elements in fixed-size contiguous blocks, and their iterators have
+ * to check for the end of the block on every increment. That branch keeps GCC from vectorizing
+ * a counting loop over the whole range. segmented_iterator_traits exposes the blocks instead, so
+ * the algorithms below run one plain loop over raw pointers per block. Iterators without a
+ * specialization are one segment. */
+
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "iter_pred.hpp"
+
+/* For a segmented iterator type: `segment(it)` is the block `it` points into (a
+ * segment_iterator, incremented to get the next block), `local(it)` its position in it (a
+ * local_iterator, a pointer), and `begin(seg)`/`end(seg)` the bounds of a whole block. */
+template<typename It>
+struct segmented_iterator_traits
+{
+        static constexpr bool is_segmented = false;
+};
+
+/* Iterator types can also opt in with a nested `segmented_traits` */
+template<typename It>
+        requires requires { typename It::segmented_traits; }
+struct segmented_iterator_traits<It> : It::segmented_traits
+{
+};
+
+#if defined(__GLIBCXX__)
+/* libstdc++'s deque: `_M_node` points into the map of blocks, `_M_cur` into the block. The
+ * finish iterator may sit at the start of a block that holds no elements yet, but the block is
+ * always allocated. */
+template<typename T, typename Ref, typename Ptr>
+struct segmented_iterator_traits<std::_Deque_iterator<T, Ref, Ptr>>
+{
+        using iterator = std::_Deque_iterator<T, Ref, Ptr>;
+        using segment_iterator = typename iterator::_Map_pointer;
+        using local_iterator = Ptr;
+
+        static constexpr bool is_segmented = true;
+
+        static segment_iterator segment(const iterator& it)
+        {
+                return it._M_node;
+        }
+
+        static local_iterator local(const iterator& it)
+        {
+                return it._M_cur;
+        }
+
+        static local_iterator begin(const segment_iterator seg)
+        {
+                return *seg;
+        }
+
+        static local_iterator end(const segment_iterator seg)
+        {
+                return *seg + iterator::_S_buffer_size();
+        }
+};
+#endif
+
+/* Calls `fn(local_first, local_last)` for each contiguous piece of [first, last), in order */
+template<std::forward_iterator It, typename Fn>
+void for_each_segment(const It first, const It last, const Fn& fn)
+{
+        using traits = segmented_iterator_traits<It>;
+        if constexpr(traits::is_segmented)
+        {
+                auto seg = traits::segment(first);
+                const auto last_seg = traits::segment(last);
+                if(seg == last_seg)
+                {
+                        fn(traits::local(first), traits::local(last));
+                        return;
+                }
+
+                fn(traits::local(first), traits::end(seg));
+                for(++seg; seg != last_seg; ++seg)
+                {
+                        fn(traits::begin(seg), traits::end(seg));
+                }
+                fn(traits::begin(last_seg), traits::local(last));
+        }
+        else
+        {
+                fn(first, last);
+        }
+}
+
+/* count_if over one piece. Integer predicate results are summed in their own type (see
+ * simd_prefers_32bit_data.md), over blocks short enough not to overflow. */
+template<std::forward_iterator It, typename Pred>
+std::size_t count_if_piece(It first, const It last, const Pred pred)
+{
+        const _Iter_pred_auto it_pred{pred};
+        using R = decltype(it_pred(first));
+
+        std::size_t count = 0;
+        if constexpr(std::contiguous_iterator<It> && std::is_integral_v<R> &&
+                     !std::is_same_v<R, bool>)
+        {
+                constexpr auto BLOCK = std::size_t(std::numeric_limits<R>::max());
+                const auto* ptr = std::to_address(first);
+                auto n = std::size_t(last - first);
+                while(n != 0)
+                {
+                        const auto len = n < BLOCK ? n : BLOCK;
+                        R partial = 0;
+                        for(std::size_t i = 0; i < len; ++i)
+                        {
+                                partial = R(partial + pred(ptr[i]));
+                        }
+                        count += std::size_t(partial);
+                        ptr += len;
+                        n -= len;
+                }
+        }
+        else
+        {
+                for(; first != last; ++first)
+                {
+                        count += bool(it_pred(first));
+                }
+        }
+        return count;
+}
+
+/* Like std::count_if, one vectorizable loop per segment. The predicate should return 0 or 1. */
+template<std::forward_iterator It, typename Pred>
+std::size_t segmented_count_if(const It first, const It last, const Pred pred)
+{
+        std::size_t count = 0;
+        for_each_segment(first, last,
+                         [&](const auto seg_first, const auto seg_last)
+                         {
+                                 count += count_if_piece(seg_first, seg_last, pred);
+                         });
+        return count;
+}
+
+/* An append-only sequence of chunks of CHUNK elements, like a rope of equal-sized leaves: it
+ * grows without moving its elements, and its iterators are segmented. Appending invalidates the
+ * iterators (not references). */
+template<typename T, std::size_t CHUNK = 4096 / sizeof(T)>
+class chunked_buffer
+{
+public:
+        static_assert(CHUNK > 0);
+
+        class const_iterator
+        {
+        public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const T*;
+                using reference = const T&;
+
+                struct segmented_traits
+                {
+                        using segment_iterator = T* const*;
+                        using local_iterator = const T*;
+
+                        static constexpr bool is_segmented = true;
+
+                        static segment_iterator segment(const const_iterator& it)
+                        {
+                                return it.chunk_;
+                        }
+
+                        /* the end of a full buffer is at offset 0 of the null entry after the
+                         * last chunk */
+                        static local_iterator local(const const_iterator& it)
+                        {
+                                return *it.chunk_ + it.offset_;
+                        }
+
+                        static local_iterator begin(const segment_iterator seg)
+                        {
+                                return *seg;
+                        }
+
+                        static local_iterator end(const segment_iterator seg)
+                        {
+                                return *seg + CHUNK;
+                        }
+                };
+
+                const_iterator() = default;
+
+                reference operator*() const
+                {
+                        return (*chunk_)[offset_];
+                }
+
+                pointer operator->() const
+                {
+                        return *chunk_ + offset_;
+                }
+
+                const_iterator& operator++()
+                {
+                        if(++offset_ == CHUNK)
+                        {
+                                ++chunk_;
+                                offset_ = 0;
+                        }
+                        return *this;
+                }
+
+                const_iterator operator++(int)
+                {
+                        auto tmp = *this;
+                        ++*this;
+                        return tmp;
+                }
+
+                bool operator==(const const_iterator&) const = default;
+
+        private:
+                friend class chunked_buffer;
+
+                T* const* chunk_ = nullptr;
+                std::size_t offset_ = 0;
+
+                const_iterator(T* const* chunk, const std::size_t offset)
+                    : chunk_(chunk),
+                      offset_(offset)
+                {
+                }
+        };
+
+        chunked_buffer()
+            : table_{nullptr}
+        {
+        }
+
+        template<std::input_iterator It>
+        chunked_buffer(It first, const It last)
+            : chunked_buffer()
+        {
+                for(; first != last; ++first)
+                {
+                        push_back(*first);
+                }
+        }
+
+        void push_back(const T& value)
+        {
+                const auto offset = size_ % CHUNK;
+                if(offset == 0)
+                {
+                        chunks_.push_back(std::make_unique_for_overwrite<T[]>(CHUNK));
+                        table_.back() = chunks_.back().get();
+                        table_.push_back(nullptr);
+                }
+                table_[size_ / CHUNK][offset] = value;
+                ++size_;
+        }
+
+        std::size_t size() const
+        {
+                return size_;
+        }
+
+        const T& operator[](const std::size_t idx) const
+        {
+                return table_[idx / CHUNK][idx % CHUNK];
+        }
+
+        const_iterator begin() const
+        {
+                return {table_.data(), 0};
+        }
+
+        const_iterator end() const
+        {
+                return {table_.data() + size_ / CHUNK, size_ % CHUNK};
+        }
+
+private:
+        std::vector<std::unique_ptr<T[]>> chunks_;
+        /* the chunks, followed by a null entry */
+        std::vector<T*> table_;
+        std::size_t size_ = 0;
+};
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "bench_context.hpp"
+#include "cache_padded.hpp"
+#include "optimization_barrier.hpp"
+#include "sharded_counter.hpp"
+
+static constexpr std::size_t INCREMENTS = 1 << 14; /* per thread and benchmark iteration */
+
+static const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+static void set_counters(benchmark::State& state)
+{
+        state.counters["incr_per_second_per_thread"] = benchmark::Counter(
+            double(state.iterations() * INCREMENTS), benchmark::Counter::kAvgThreadsRate);
+}
+
+/* Every thread increments the same atomic */
+static void shared_atomic(benchmark::State& state)
+{
+        static std::atomic<std::uint64_t> counter{0};
+
+        for(auto _ : state)
+        {
+                for(std::size_t i = 0; i < INCREMENTS; ++i)
+                {
+                        counter.fetch_add(1, std::memory_order_relaxed);
+                }
+        }
+
+        set_counters(state);
+}
+
+/* Every thread increments its own padded slot (the fixed false_sharing.cpp); the reader has to
+ * know the threads, and reads are racy unless the writers are done */
+struct Storage
+{
+        std::uint64_t val{0};
+};
+
+static void padded_storage(benchmark::State& state)
+{
+        static per_thread<Storage> results{max_threads};
+        auto& ref = results[std::size_t(state.thread_index())].val;
+
+        for(auto _ : state)
+        {
+                for(std::size_t i = 0; i < INCREMENTS; ++i)
+                {
+                        ++ref;
+                        clobber_memory();
+                }
+        }
+
+        set_counters(state);
+}
+
+template<shard_policy POLICY>
+static void sharded(benchmark::State& state)
+{
+        static sharded_counter<POLICY> counter;
+
+        for(auto _ : state)
+        {
+                for(std::size_t i = 0; i < INCREMENTS; ++i)
+                {
+                        counter.add();
+                }
+        }
+
+        set_counters(state);
+}
+
+BENCHMARK(shared_atomic)->DenseThreadRange(1, int(max_threads))->UseRealTime();
+BENCHMARK(padded_storage)->DenseThreadRange(1, int(max_threads))->UseRealTime();
+BENCHMARK_TEMPLATE(sharded, shard_policy::cpu)
+    ->DenseThreadRange(1, int(max_threads))
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(sharded, shard_policy::thread)
+    ->DenseThreadRange(1, int(max_threads))
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,74 @@
+#pragma once
+
+/* A counter for hot-path statistics: increments go to one of several cache-padded shards instead
+ * of a single contended atomic, reads sum the shards. */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <thread>
+
+#include <sched.h>
+
+#include "cache_padded.hpp"
+
+enum class shard_policy
+{
+        cpu,    /* shard of the CPU the caller runs on (sched_getcpu(), served from rseq/vDSO) */
+        thread, /* shard assigned round-robin to each thread on first use */
+};
+
+template<shard_policy POLICY = shard_policy::cpu>
+class sharded_counter
+{
+public:
+        /* The shard count is rounded up to a power of two; by default one shard per hardware
+         * thread. */
+        explicit sharded_counter(const std::size_t shards = std::thread::hardware_concurrency())
+            : shards_(std::bit_ceil(std::max<std::size_t>(shards, 1)))
+            , mask_(shards_.size() - 1)
+        {
+        }
+
+        /* Shards are shared only when two CPUs (or threads) map to the same one, or when a
+         * thread migrates between picking a shard and updating it, so the RMW is uncontended in
+         * the common case. */
+        void add(const std::uint64_t n = 1)
+        {
+                shards_[shard_index() & mask_].fetch_add(n, std::memory_order_relaxed);
+        }
+
+        /* Sum of the shards. Exact once the writers are done (and their increments happen-before
+         * the read, e.g. after joining them); with concurrent writers the result lies between the
+         * counts at the start and at the end of the read. */
+        std::uint64_t read() const
+        {
+                return shards_.combine();
+        }
+
+        std::size_t shards() const
+        {
+                return shards_.size();
+        }
+
+private:
+        per_thread<std::atomic<std::uint64_t>> shards_;
+        std::size_t mask_;
+
+        static std::size_t shard_index()
+        {
+                if constexpr(POLICY == shard_policy::cpu)
+                {
+                        const int cpu = ::sched_getcpu();
+                        return cpu < 0 ? 0 : std::size_t(cpu);
+                }
+                else
+                {
+                        static std::atomic<std::size_t> next{0};
+                        thread_local const std::size_t idx =
+                            next.fetch_add(1, std::memory_order_relaxed);
+                        return idx;
+                }
+        }
+};
@@ -0,0 +1,192 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "optimization_barrier.hpp"
+#include "simd_compact.hpp"
+
+using element_type = std::uint32_t;
+
+static constexpr std::size_t SIZE = 1 << 20;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+/* Selectivity: the fraction of even elements */
+static const distribution_params DISTRIBUTIONS[] = {
+    {distribution::all_odd},
+    {distribution::match_probability, 0.01},
+    {distribution::match_probability, 0.1},
+    {distribution::match_probability, 0.25},
+    {distribution::uniform},
+    {distribution::match_probability, 0.75},
+    {distribution::match_probability, 0.9},
+    {distribution::match_probability, 0.99},
+    {distribution::all_even},
+};
+
+static const auto test_vecs = []
+{
+        std::vector<dataset<element_type>> vecs;
+        for(const auto& params : DISTRIBUTIONS)
+        {
+                vecs.push_back(distribution_dataset<element_type>(SIZE, SEED, params));
+        }
+        return vecs;
+}();
+
+static constexpr auto is_even = [](const element_type el) -> element_type
+{
+        return el % 2 == 0;
+};
+
+static void finish(benchmark::State& state)
+{
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE * sizeof(element_type)));
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(0)]));
+}
+
+/* copy_if into a buffer large enough for every element */
+static void std_copy_if(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<element_type> out(SIZE);
+
+        for(auto _ : state)
+        {
+                const auto end = std::copy_if(vec.begin(), vec.end(), out.begin(), is_even);
+                benchmark::DoNotOptimize(end);
+                clobber_memory();
+        }
+
+        finish(state);
+}
+
+static void simd_copy_if(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<element_type> out(SIZE);
+
+        for(auto _ : state)
+        {
+                const auto end = compact_copy_if(vec.begin(), vec.end(), out.data(), is_even);
+                benchmark::DoNotOptimize(end);
+                clobber_memory();
+        }
+
+        finish(state);
+}
+
+/* Materializing into a new vector: push_back growth vs. counting first */
+static void std_copy_if_back_inserter(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+
+        for(auto _ : state)
+        {
+                std::vector<element_type> out;
+                std::copy_if(vec.begin(), vec.end(), std::back_inserter(out), is_even);
+                benchmark::DoNotOptimize(out.data());
+        }
+
+        finish(state);
+}
+
+static void simd_copy_matches(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+
+        for(auto _ : state)
+        {
+                const auto out = copy_matches<element_type>(vec, is_even);
+                benchmark::DoNotOptimize(out.data());
+        }
+
+        finish(state);
+}
+
+/* remove_if works in place, so both variants also copy the input to the scratch buffer */
+static void std_remove_if(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<element_type> scratch(SIZE);
+
+        for(auto _ : state)
+        {
+                std::copy(vec.begin(), vec.end(), scratch.begin());
+                const auto end = std::remove_if(scratch.begin(), scratch.end(), is_even);
+                benchmark::DoNotOptimize(end);
+                clobber_memory();
+        }
+
+        finish(state);
+}
+
+static void simd_remove_if(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<element_type> scratch(SIZE);
+
+        for(auto _ : state)
+        {
+                std::copy(vec.begin(), vec.end(), scratch.begin());
+                const auto end =
+                    compact_remove_if(scratch.data(), scratch.data() + scratch.size(), is_even);
+                benchmark::DoNotOptimize(end);
+                clobber_memory();
+        }
+
+        finish(state);
+}
+
+static void scalar_select_indices(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<std::uint32_t> out(SIZE);
+
+        for(auto _ : state)
+        {
+                auto it = out.data();
+                for(std::size_t i = 0; i < vec.size(); ++i)
+                {
+                        if(is_even(vec[i]))
+                        {
+                                *it++ = std::uint32_t(i);
+                        }
+                }
+                benchmark::DoNotOptimize(it);
+                clobber_memory();
+        }
+
+        finish(state);
+}
+
+static void simd_select_indices(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<std::uint32_t> out(SIZE);
+
+        for(auto _ : state)
+        {
+                const auto end = select_indices(vec.begin(), vec.end(), out.data(), is_even);
+                benchmark::DoNotOptimize(end);
+                clobber_memory();
+        }
+
+        finish(state);
+}
+
+static constexpr int NUM_DISTRIBUTIONS = int(std::size(DISTRIBUTIONS));
+
+BENCHMARK(std_copy_if)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(simd_copy_if)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(std_copy_if_back_inserter)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(simd_copy_matches)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(std_remove_if)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(simd_remove_if)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(scalar_select_indices)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(simd_select_indices)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,227 @@
+#pragma once
+
+/* Stream compaction: the elements (or the indices of the elements) that satisfy a predicate,
+ * packed together. For 4-byte elements a block of lanes is handled at once: the predicate is
+ * evaluated over the block into a flag array (a branch-free loop GCC vectorizes, as long as the
+ * predicate doesn't return `bool`), the flags become a lane mask, and the selected lanes are
+ * packed with `vpcompressd` on AVX-512 or with a permutation table (`vpermd`) on AVX2; only the
+ * selected elements are stored. Other element types, the tail and other targets use the scalar
+ * loop. */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+inline constexpr std::size_t COMPACT_LANES = 16;
+#elif defined(__AVX2__)
+inline constexpr std::size_t COMPACT_LANES = 8;
+#else
+inline constexpr std::size_t COMPACT_LANES = 0;
+#endif
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+/* For every 8-bit lane mask, the indices of the set lanes in ascending order, one byte each */
+inline constexpr auto COMPACT_PERMUTATIONS = []
+{
+        std::array<std::uint64_t, 256> table{};
+        for(unsigned mask = 0; mask < 256; ++mask)
+        {
+                unsigned out = 0;
+                for(unsigned lane = 0; lane < 8; ++lane)
+                {
+                        if(mask & (1u << lane))
+                        {
+                                table[mask] |= std::uint64_t(lane) << (8 * out++);
+                        }
+                }
+        }
+        return table;
+}();
+#endif
+
+#if defined(__AVX512F__)
+using compact_mask = std::uint16_t;
+using compact_vector = __m512i;
+#elif defined(__AVX2__)
+using compact_mask = std::uint8_t;
+using compact_vector = __m256i;
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+/* Lane mask of the block starting at `block`; the predicate result is only converted to a flag
+ * word, never branched on */
+template<typename T, typename Pred>
+inline compact_mask compact_block_mask(const T* block, const Pred& pred)
+{
+        alignas(64) std::uint32_t flags[COMPACT_LANES];
+        for(std::size_t i = 0; i < COMPACT_LANES; ++i)
+        {
+                flags[i] = pred(block[i]) ? ~0u : 0u;
+        }
+
+#if defined(__AVX512F__)
+        const auto v = _mm512_load_si512(flags);
+        return _mm512_test_epi32_mask(v, v);
+#else
+        return compact_mask(
+            _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_load_si256((const __m256i*)flags))));
+#endif
+}
+
+/* Stores the lanes of `v` selected by `mask` contiguously at `out`; returns the new end */
+template<typename Out>
+inline Out* compact_store(Out* out, const compact_mask mask, const compact_vector v)
+{
+#if defined(__AVX512F__)
+        _mm512_mask_compressstoreu_epi32(out, mask, v);
+#else
+        const auto indices =
+            _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(std::int64_t(COMPACT_PERMUTATIONS[mask])));
+        const auto count = __builtin_popcount(mask);
+        /* lanes [0, count) */
+        const auto store_mask =
+            _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        _mm256_maskstore_epi32((int*)out, store_mask, _mm256_permutevar8x32_epi32(v, indices));
+#endif
+        return out + __builtin_popcount(mask);
+}
+#endif
+
+/* Copies the elements for which `pred(el)` equals KEEP_MATCHES. `out` may alias `first` (in-place
+ * removal): a block is loaded before anything is written over it. */
+template<bool KEEP_MATCHES, typename T, typename Pred>
+T* compact(const T* first, const T* last, T* out, const Pred pred)
+{
+#if defined(__AVX512F__) || defined(__AVX2__)
+        if constexpr(sizeof(T) == 4 && std::is_trivially_copyable_v<T>)
+        {
+                for(; std::size_t(last - first) >= COMPACT_LANES; first += COMPACT_LANES)
+                {
+                        auto mask = compact_block_mask(first, pred);
+                        if constexpr(!KEEP_MATCHES)
+                        {
+                                mask = compact_mask(~mask);
+                        }
+#if defined(__AVX512F__)
+                        out = compact_store(out, mask, _mm512_loadu_si512(first));
+#else
+                        out = compact_store(out, mask, _mm256_loadu_si256((const __m256i*)first));
+#endif
+                }
+        }
+#endif
+
+        for(; first != last; ++first)
+        {
+                if(bool(pred(*first)) == KEEP_MATCHES)
+                {
+                        *out++ = *first;
+                }
+        }
+        return out;
+}
+
+/* std::copy_if for contiguous ranges; returns the end of the output */
+template<typename T, typename Pred>
+T* compact_copy_if(const T* first, const T* last, T* out, const Pred pred)
+{
+        return compact<true>(first, last, out, pred);
+}
+
+/* std::remove_if for contiguous ranges: the kept elements are moved to the front, in order;
+ * returns their new end */
+template<typename T, typename Pred>
+T* compact_remove_if(T* first, T* last, const Pred pred)
+{
+        return compact<false>(first, last, first, pred);
+}
+
+/* Writes the positions (relative to `first`, below 2^32) of the matching elements to `out`;
+ * returns the end of the output */
+template<typename T, typename Pred>
+std::uint32_t* select_indices(const T* first, const T* last, std::uint32_t* out, const Pred pred)
+{
+        const T* const begin = first;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+        if constexpr(sizeof(T) == 4 && std::is_trivially_copyable_v<T>)
+        {
+#if defined(__AVX512F__)
+                const auto step = _mm512_set1_epi32(int(COMPACT_LANES));
+                auto indices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+                                                 14, 15);
+                for(; std::size_t(last - first) >= COMPACT_LANES; first += COMPACT_LANES)
+                {
+                        out = compact_store(out, compact_block_mask(first, pred), indices);
+                        indices = _mm512_add_epi32(indices, step);
+                }
+#else
+                const auto step = _mm256_set1_epi32(int(COMPACT_LANES));
+                auto indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                for(; std::size_t(last - first) >= COMPACT_LANES; first += COMPACT_LANES)
+                {
+                        out = compact_store(out, compact_block_mask(first, pred), indices);
+                        indices = _mm256_add_epi32(indices, step);
+                }
+#endif
+        }
+#endif
+
+        for(; first != last; ++first)
+        {
+                if(pred(*first))
+                {
+                        *out++ = std::uint32_t(first - begin);
+                }
+        }
+        return out;
+}
+
+/* Number of matches, with the vectorizable accumulation of simd_prefers_32bit_data.md: 32-bit
+ * partial counts over blocks that can't overflow them */
+template<typename T, typename Pred>
+std::size_t compact_count(const std::span<const T> data, const Pred pred)
+{
+        static constexpr std::size_t BLOCK = std::size_t(1) << 20;
+
+        std::size_t total = 0;
+        for(std::size_t start = 0; start < data.size(); start += BLOCK)
+        {
+                const auto end = std::min(data.size(), start + BLOCK);
+                std::uint32_t partial = 0;
+                for(std::size_t i = start; i < end; ++i)
+                {
+                        partial += pred(data[i]);
+                }
+                total += partial;
+        }
+        return total;
+}
+
+/* The matching elements in a vector sized by a counting pass first, so that the compaction
+ * doesn't grow it */
+template<typename T, typename Pred>
+std::vector<T> copy_matches(const std::span<const T> data, const Pred pred)
+{
+        std::vector<T> out(compact_count(data, pred));
+        compact_copy_if(data.data(), data.data() + data.size(), out.data(), pred);
+        return out;
+}
+
+template<typename T, typename Pred>
+std::vector<std::uint32_t> select_match_indices(const std::span<const T> data, const Pred pred)
+{
+        std::vector<std::uint32_t> out(compact_count(data, pred));
+        select_indices(data.data(), data.data() + data.size(), out.data(), pred);
+        return out;
+}
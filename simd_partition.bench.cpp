@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "dataset.hpp"
+#include "optimization_barrier.hpp"
+#include "simd_partition.hpp"
+
+using element_type = std::uint32_t;
+
+static constexpr std::size_t SIZE = 1 << 20;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+/* The std algorithms branch on every element, so predictability matters to them */
+static const distribution_params DISTRIBUTIONS[] = {
+    {distribution::uniform},
+    {distribution::all_even},
+    {distribution::all_odd},
+    {distribution::alternating},
+    {distribution::long_runs, 0.5, 16},
+    {distribution::long_runs, 0.5, 4096},
+    {distribution::sorted},
+    {distribution::match_probability, 0.1},
+    {distribution::match_probability, 0.9},
+};
+
+static const auto test_vecs = []
+{
+        std::vector<dataset<element_type>> vecs;
+        for(const auto& params : DISTRIBUTIONS)
+        {
+                vecs.push_back(distribution_dataset<element_type>(SIZE, SEED, params));
+        }
+        return vecs;
+}();
+
+static constexpr auto is_even = [](const element_type el) -> element_type
+{
+        return el % 2 == 0;
+};
+
+/* Partitioning is in place, so every iteration first restores the input; the copy is part of
+ * all the timings */
+template<typename Partition>
+static void run(benchmark::State& state, const Partition& partition)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        std::vector<element_type> data(SIZE);
+
+        for(auto _ : state)
+        {
+                std::copy(vec.begin(), vec.end(), data.begin());
+                const auto mid = partition(data.data(), data.data() + data.size());
+                benchmark::DoNotOptimize(mid);
+                clobber_memory();
+        }
+
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE * sizeof(element_type)));
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(0)]));
+}
+
+static void copy_only(benchmark::State& state)
+{
+        run(state,
+            [](element_type* first, element_type*)
+            {
+                    return first;
+            });
+}
+
+static void std_partition(benchmark::State& state)
+{
+        run(state,
+            [](element_type* first, element_type* last)
+            {
+                    return std::partition(first, last, is_even);
+            });
+}
+
+static void vectorized_partition(benchmark::State& state)
+{
+        run(state,
+            [](element_type* first, element_type* last)
+            {
+                    return simd_partition(first, last, is_even);
+            });
+}
+
+static void std_stable_partition(benchmark::State& state)
+{
+        run(state,
+            [](element_type* first, element_type* last)
+            {
+                    return std::stable_partition(first, last, is_even);
+            });
+}
+
+/* with a scratch buffer allocated once, like std::stable_partition's temporary buffer can't be */
+static void vectorized_stable_partition(benchmark::State& state)
+{
+        std::vector<element_type> scratch(SIZE);
+        run(state,
+            [&scratch](element_type* first, element_type* last)
+            {
+                    return simd_stable_partition(first, last, is_even, scratch.data());
+            });
+}
+
+static constexpr int NUM_DISTRIBUTIONS = int(std::size(DISTRIBUTIONS));
+
+BENCHMARK(copy_only)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(std_partition)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(vectorized_partition)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(std_stable_partition)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(vectorized_stable_partition)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+
+BENCHMARK_MAIN();
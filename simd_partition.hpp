@@ -0,0 +1,141 @@
+#pragma once
+
+/* Branch-free partition of contiguous ranges of 4-byte elements, built on the block masks and
+ * compressed stores of simd_compact.hpp; other element types and targets use the standard
+ * algorithms. */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "simd_compact.hpp"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+inline compact_vector compact_load(const void* ptr)
+{
+#if defined(__AVX512F__)
+        return _mm512_loadu_si512(ptr);
+#else
+        return _mm256_loadu_si256((const __m256i*)ptr);
+#endif
+}
+
+/* Writes the matches of a block at `left` (growing up) and the others below `right` (growing
+ * down); the destination slots must already have been read */
+template<typename T, typename Pred>
+inline void partition_block(const T* block, const compact_vector v, T*& left, T*& right,
+                            const Pred& pred)
+{
+        const auto mask = compact_block_mask(block, pred);
+        const auto matches = std::size_t(__builtin_popcount(mask));
+        right -= COMPACT_LANES - matches;
+        compact_store(right, compact_mask(~mask), v);
+        left = compact_store(left, mask, v);
+}
+#endif
+
+/* Like std::partition: matches first, returns the first non-match; the order within each side is
+ * unspecified. Blocks are read from whichever end has less free space, and their matches and
+ * non-matches are compressed to the two write fronts, so there are no data-dependent branches.
+ * The first and last blocks are held in registers to open up room at both ends. */
+template<typename T, typename Pred>
+T* simd_partition(T* first, T* last, const Pred pred)
+{
+#if defined(__AVX512F__) || defined(__AVX2__)
+        if constexpr(sizeof(T) == 4 && std::is_trivially_copyable_v<T>)
+        {
+                const auto n = std::size_t(last - first);
+                T* left = first;
+                T* right = last;
+
+                if(n >= 2 * COMPACT_LANES)
+                {
+                        alignas(64) T head[COMPACT_LANES];
+                        alignas(64) T tail[COMPACT_LANES];
+                        std::memcpy(head, first, sizeof(head));
+                        std::memcpy(tail, last - COMPACT_LANES, sizeof(tail));
+                        const T* read_left = first + COMPACT_LANES;
+                        const T* read_right = last - COMPACT_LANES;
+
+                        while(std::size_t(read_right - read_left) >= COMPACT_LANES)
+                        {
+                                const T* block;
+                                if(read_left - left <= right - read_right)
+                                {
+                                        block = read_left;
+                                        read_left += COMPACT_LANES;
+                                }
+                                else
+                                {
+                                        read_right -= COMPACT_LANES;
+                                        block = read_right;
+                                }
+                                partition_block(block, compact_load(block), left, right, pred);
+                        }
+
+                        /* everything is read now: the rest goes through a buffer */
+                        alignas(64) T rest[COMPACT_LANES];
+                        const auto rest_size = std::size_t(read_right - read_left);
+                        std::memcpy(rest, read_left, rest_size * sizeof(T));
+
+                        partition_block(head, compact_load(head), left, right, pred);
+                        partition_block(tail, compact_load(tail), left, right, pred);
+                        for(std::size_t i = 0; i < rest_size; ++i)
+                        {
+                                const bool match = pred(rest[i]);
+                                *left = rest[i];
+                                right[-1] = rest[i];
+                                left += match;
+                                right -= !match;
+                        }
+                        return left;
+                }
+        }
+#endif
+        return std::partition(first, last, pred);
+}
+
+/* Like std::stable_partition. Matches are compressed in place (the write front never passes the
+ * read front), non-matches to `scratch` (room for `last - first` elements) and copied back after
+ * them. */
+template<typename T, typename Pred>
+T* simd_stable_partition(T* first, T* last, const Pred pred, T* scratch)
+{
+#if defined(__AVX512F__) || defined(__AVX2__)
+        if constexpr(sizeof(T) == 4 && std::is_trivially_copyable_v<T>)
+        {
+                T* left = first;
+                T* others = scratch;
+                for(; std::size_t(last - first) >= COMPACT_LANES; first += COMPACT_LANES)
+                {
+                        const auto mask = compact_block_mask(first, pred);
+                        const auto v = compact_load(first);
+                        others = compact_store(others, compact_mask(~mask), v);
+                        left = compact_store(left, mask, v);
+                }
+                for(; first != last; ++first)
+                {
+                        const bool match = pred(*first);
+                        const T value = *first;
+                        *left = value;
+                        *others = value;
+                        left += match;
+                        others += !match;
+                }
+
+                std::memcpy(left, scratch, std::size_t(others - scratch) * sizeof(T));
+                return left;
+        }
+#endif
+        (void)scratch;
+        return std::stable_partition(first, last, pred);
+}
+
+template<typename T, typename Pred>
+T* simd_stable_partition(T* first, T* last, const Pred pred)
+{
+        std::vector<T> scratch(std::size_t(last - first));
+        return simd_stable_partition(first, last, pred, scratch.data());
+}
@@ -1,9 +1,12 @@
 #include <benchmark/benchmark.h>
-#include <random>
-#include <ctime>
 #include <vector>
 #include <span>
-#include <random>
+
+#include "bench_context.hpp"
+#include "cache_padded.hpp"
+#include "dataset.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
 
 using element_type = std::uint32_t;
 using vec_iter_t = std::vector<element_type>::iterator;
@@ -11,20 +14,14 @@ using vec_iter_diff_t = std::iterator_traits<vec_iter_t>::difference_type;
 
 static constexpr std::size_t SIZE = 1 << 25;
 
-static const auto global_vec = []()
-{
-        std::vector<element_type> vec;
-        vec.reserve(SIZE);
+static constexpr std::uint64_t SEED = 0x5eed;
 
-        std::mt19937 gen(std::random_device{}());
-        std::uniform_int_distribution<element_type> distrib;
-        for(std::size_t i = 0; i < SIZE; ++i)
-        {
-                vec.push_back(distrib(gen));
-        }
+static const auto global_vec = uniform_dataset<element_type>(SIZE, SEED);
+
+static const auto caches = detect_caches();
 
-        return vec;
-}();
+/* Pinned workers, created once for all the parallel runs */
+static thread_pool pool;
 
 static constexpr auto is_even = []<typename T>(const element_type el) -> T
 {
@@ -56,6 +53,7 @@ static void assume_difference_type(benchmark::State& state)
 
         state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(state.range(0)) *
                                 sizeof(element_type));
+        state.SetLabel(cache_label(caches, std::size_t(state.range(0)) * sizeof(element_type)));
 }
 
 static void assume_element_type(benchmark::State& state)
@@ -72,6 +70,7 @@ static void assume_element_type(benchmark::State& state)
 
         state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(state.range(0)) *
                                 sizeof(element_type));
+        state.SetLabel(cache_label(caches, std::size_t(state.range(0)) * sizeof(element_type)));
 }
 
 static void std_countif(benchmark::State& state)
@@ -91,14 +90,52 @@ static void std_countif(benchmark::State& state)
 
         state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(state.range(0)) *
                                 sizeof(element_type));
+        state.SetLabel(cache_label(caches, std::size_t(state.range(0)) * sizeof(element_type)));
+}
+
+/* `assume_element_type` on one chunk per worker of the persistent pool; the per-worker counts
+ * are padded so that the final stores don't false-share */
+static void parallel_assume_element_type(benchmark::State& state)
+{
+        const auto test_vec =
+            std::span{global_vec.begin(), static_cast<std::size_t>(state.range(0))};
+        per_thread<element_type> partial(pool.size());
+
+        for(auto _ : state)
+        {
+                pool.parallel_for(0, test_vec.size(),
+                                  [&](const std::size_t first, const std::size_t last,
+                                      const std::size_t idx)
+                                  {
+                                          partial[idx] = mcount_if<element_type>(
+                                              test_vec.begin() + first, test_vec.begin() + last,
+                                              is_even);
+                                  });
+                const auto tmp = partial.combine();
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(state.range(0)) *
+                                sizeof(element_type));
+        state.SetLabel(cache_label(caches, std::size_t(state.range(0)) * sizeof(element_type)));
 }
 
 static constexpr std::size_t STEP = 4ul;
 static constexpr std::size_t LEFT = std::min(1ul << 10ul, SIZE);
 static constexpr std::size_t RIGHT = std::min(1ul << 25ul, SIZE);
 
-BENCHMARK(assume_difference_type)->RangeMultiplier(STEP)->Range(LEFT, RIGHT);
-BENCHMARK(assume_element_type)->RangeMultiplier(STEP)->Range(LEFT, RIGHT);
-BENCHMARK(std_countif)->RangeMultiplier(STEP)->Range(LEFT, RIGHT);
+/* The coarse [LEFT, RIGHT] sweep is densified around every cache boundary of the host */
+static void cache_sized_args(benchmark::internal::Benchmark* b)
+{
+        for(const auto n : cache_bracketing_sizes<element_type>(caches, LEFT, RIGHT, STEP))
+        {
+                b->Arg(static_cast<int64_t>(n));
+        }
+}
+
+BENCHMARK(assume_difference_type)->Apply(cache_sized_args);
+BENCHMARK(assume_element_type)->Apply(cache_sized_args);
+BENCHMARK(std_countif)->Apply(cache_sized_args);
+BENCHMARK(parallel_assume_element_type)->Apply(cache_sized_args)->UseRealTime();
 
 BENCHMARK_MAIN();
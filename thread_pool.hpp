@@ -0,0 +1,263 @@
+#pragma once
+
+/* A persistent fork-join pool for the parallel experiments: workers are created once, pinned to
+ * one CPU each, and wait for work by spinning for a short while and then parking on a futex. */
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+}
+
+/* CPUs the process may run on, in ascending order */
+inline std::vector<int> allowed_cpus()
+{
+        std::vector<int> cpus;
+        cpu_set_t set;
+        if(::sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+                for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                {
+                        if(CPU_ISSET(cpu, &set))
+                        {
+                                cpus.push_back(cpu);
+                        }
+                }
+        }
+        return cpus;
+}
+
+inline bool pin_current_thread(const int cpu)
+{
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+/* A 32-bit word that threads wait on until it changes */
+class wait_word
+{
+public:
+        std::uint32_t load() const
+        {
+                return word_.load(std::memory_order_acquire);
+        }
+
+        /* Returns once the value differs from `old`: spins `spin` times (yielding now and then),
+         * then sleeps */
+        void wait_while_equal(const std::uint32_t old, const unsigned spin) const
+        {
+                for(unsigned i = 0; i < spin; ++i)
+                {
+                        if(word_.load(std::memory_order_acquire) != old)
+                        {
+                                return;
+                        }
+                        cpu_relax();
+                        /* lets the thread we're waiting for run when CPUs are oversubscribed */
+                        if(i % 256 == 255)
+                        {
+                                ::sched_yield();
+                        }
+                }
+
+                /* seq_cst on both sides: either the waker sees the sleeper, or the sleeper sees
+                 * the new value */
+                sleepers_.fetch_add(1, std::memory_order_seq_cst);
+                while(word_.load(std::memory_order_seq_cst) == old)
+                {
+                        ::syscall(SYS_futex, &word_, FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+                }
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /* Sets a new value (different from the current one) and wakes the sleepers, if any (no
+         * syscall otherwise) */
+        void store_and_wake(const std::uint32_t value)
+        {
+                word_.store(value, std::memory_order_seq_cst);
+                if(sleepers_.load(std::memory_order_seq_cst) != 0)
+                {
+                        ::syscall(SYS_futex, &word_, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr,
+                                  0);
+                }
+        }
+
+private:
+        std::atomic<std::uint32_t> word_{0};
+        mutable std::atomic<std::uint32_t> sleepers_{0};
+        static_assert(sizeof(word_) == 4, "used as a futex");
+};
+
+/* `run`/`parallel_for` must not be called concurrently from several threads, or from inside a
+ * job. */
+class thread_pool
+{
+public:
+        /* iterations of the pause loop before a waiting thread parks */
+        static constexpr unsigned DEFAULT_SPIN = 1 << 14;
+
+        /* the participant count of a job is published in the low bits of the epoch word, so that
+         * workers left out of a job never read the job description */
+        static constexpr unsigned WORKER_BITS = 12;
+        static constexpr std::size_t MAX_WORKERS = (std::size_t(1) << WORKER_BITS) - 1;
+
+        /* One worker per entry of `cpus` (at most MAX_WORKERS), pinned to that CPU (or not
+         * pinned if negative) */
+        explicit thread_pool(const std::vector<int>& cpus, const unsigned spin = DEFAULT_SPIN)
+            : spin_(spin)
+        {
+                const auto nworkers = std::min(cpus.size(), MAX_WORKERS);
+                workers_.reserve(nworkers);
+                for(std::size_t idx = 0; idx < nworkers; ++idx)
+                {
+                        workers_.emplace_back(&thread_pool::worker_loop, this, idx, cpus[idx]);
+                }
+        }
+
+        /* `nthreads` workers pinned to the allowed CPUs in order, wrapping around if there are
+         * more workers than CPUs */
+        explicit thread_pool(const std::size_t nthreads = std::thread::hardware_concurrency())
+            : thread_pool(spread_over_cpus(std::max<std::size_t>(nthreads, 1)))
+        {
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        ~thread_pool()
+        {
+                stop_.store(true, std::memory_order_relaxed);
+                epoch_.store_and_wake(++generation_ << WORKER_BITS);
+                for(auto& w : workers_)
+                {
+                        w.join();
+                }
+        }
+
+        std::size_t size() const
+        {
+                return workers_.size();
+        }
+
+        /* Calls `fn(worker_index)` on workers [0, nworkers) and waits for all of them */
+        template<typename Fn>
+        void run(std::size_t nworkers, const Fn& fn)
+        {
+                nworkers = std::min(nworkers, size());
+                if(nworkers == 0)
+                {
+                        return;
+                }
+
+                job_ctx_ = &fn;
+                job_fn_ = [](const void* ctx, const std::size_t idx)
+                {
+                        (*static_cast<const Fn*>(ctx))(idx);
+                };
+                pending_.store(std::uint32_t(nworkers), std::memory_order_relaxed);
+
+                const auto done = done_.load();
+                epoch_.store_and_wake((++generation_ << WORKER_BITS) | std::uint32_t(nworkers));
+                done_.wait_while_equal(done, spin_);
+        }
+
+        template<typename Fn>
+        void run(const Fn& fn)
+        {
+                run(size(), fn);
+        }
+
+        /* Splits [first, last) into one contiguous chunk per worker (at most `nworkers`) and calls
+         * `fn(chunk_first, chunk_last, worker_index)` for each */
+        template<typename Fn>
+        void parallel_for(const std::size_t first, const std::size_t last, const Fn& fn,
+                          const std::size_t nworkers = SIZE_MAX)
+        {
+                const auto n = last - first;
+                const auto w = std::min({nworkers, size(), std::max<std::size_t>(n, 1)});
+                run(w,
+                    [&](const std::size_t idx)
+                    {
+                            fn(first + n * idx / w, first + n * (idx + 1) / w, idx);
+                    });
+        }
+
+private:
+        std::vector<std::thread> workers_;
+        unsigned spin_;
+        std::atomic<bool> stop_{false};
+
+        std::uint32_t generation_ = 0;
+        wait_word epoch_;
+        wait_word done_;
+        std::atomic<std::uint32_t> pending_{0};
+
+        const void* job_ctx_ = nullptr;
+        void (*job_fn_)(const void*, std::size_t) = nullptr;
+
+        static std::vector<int> spread_over_cpus(const std::size_t nthreads)
+        {
+                auto allowed = allowed_cpus();
+                if(allowed.empty())
+                {
+                        allowed.push_back(-1);
+                }
+
+                std::vector<int> cpus(nthreads);
+                for(std::size_t i = 0; i < nthreads; ++i)
+                {
+                        cpus[i] = allowed[i % allowed.size()];
+                }
+                return cpus;
+        }
+
+        void worker_loop(const std::size_t idx, const int cpu)
+        {
+                if(cpu >= 0)
+                {
+                        pin_current_thread(cpu);
+                }
+
+                for(std::uint32_t epoch = 0;;)
+                {
+                        epoch_.wait_while_equal(epoch, spin_);
+                        epoch = epoch_.load();
+                        if(stop_.load(std::memory_order_relaxed))
+                        {
+                                return;
+                        }
+                        if(idx >= (epoch & MAX_WORKERS))
+                        {
+                                continue;
+                        }
+
+                        job_fn_(job_ctx_, idx);
+                        if(pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        {
+                                done_.store_and_wake(done_.load() + 1);
+                        }
+                }
+        }
+};
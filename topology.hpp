@@ -0,0 +1,277 @@
+#pragma once
+
+/* Host topology as reported by Linux sysfs. */
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct cache_level
+{
+        unsigned level;
+        std::string name; /* "L1d", "L2", "L3", ... */
+        std::size_t size; /* in bytes */
+};
+
+inline std::string read_sysfs_line(const std::string& path)
+{
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        return line;
+}
+
+/* sysfs reports sizes as e.g. "48K", "2048K", "300M" */
+inline std::size_t parse_sysfs_size(const std::string& str)
+{
+        std::size_t value = 0;
+        std::size_t i = 0;
+        for(; i < str.size() && str[i] >= '0' && str[i] <= '9'; ++i)
+        {
+                value = value * 10 + std::size_t(str[i] - '0');
+        }
+
+        switch(i < str.size() ? str[i] : '\0')
+        {
+        case 'K':
+                return value << 10;
+        case 'M':
+                return value << 20;
+        case 'G':
+                return value << 30;
+        default:
+                return value;
+        }
+}
+
+/* Data and unified caches seen by cpu0, innermost first. Empty if sysfs isn't available. */
+inline std::vector<cache_level> detect_caches()
+{
+        std::vector<cache_level> caches;
+
+        for(unsigned idx = 0;; ++idx)
+        {
+                const auto dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(idx);
+                const auto level = read_sysfs_line(dir + "/level");
+                const auto type = read_sysfs_line(dir + "/type");
+                if(level.empty() || type.empty())
+                {
+                        break;
+                }
+                if(type == "Instruction")
+                {
+                        continue;
+                }
+
+                const auto size = parse_sysfs_size(read_sysfs_line(dir + "/size"));
+                if(size == 0)
+                {
+                        continue;
+                }
+
+                auto name = "L" + level;
+                if(type == "Data")
+                {
+                        name += 'd';
+                }
+                caches.push_back({unsigned(std::stoul(level)), std::move(name), size});
+        }
+
+        std::sort(caches.begin(), caches.end(),
+                  [](const cache_level& lhs, const cache_level& rhs)
+                  {
+                          return lhs.level < rhs.level;
+                  });
+        return caches;
+}
+
+/* Innermost cache level that a working set of `bytes` fits in ("DRAM" if none) */
+inline const char* cache_label(const std::vector<cache_level>& caches, const std::size_t bytes)
+{
+        for(const auto& cache : caches)
+        {
+                if(bytes <= cache.size)
+                {
+                        return cache.name.c_str();
+                }
+        }
+        return "DRAM";
+}
+
+/* Element counts for a benchmark sweep: the coarse geometric range [left, right] with
+ * multiplier `step`, plus points at 1/2, 3/4, 7/8, 1, 9/8, 5/4, 3/2 and 2 times every cache
+ * size so that each boundary is bracketed densely. Sorted, deduplicated, clamped to
+ * [left, right]. */
+template<typename T>
+std::vector<std::size_t> cache_bracketing_sizes(const std::vector<cache_level>& caches,
+                                                const std::size_t left, const std::size_t right,
+                                                const std::size_t step)
+{
+        std::vector<std::size_t> sizes;
+        for(std::size_t n = left; n <= right; n *= step)
+        {
+                sizes.push_back(n);
+        }
+        /* like benchmark::Range(), the upper bound is always included */
+        sizes.push_back(right);
+
+        static constexpr std::size_t FRACTIONS[][2] = {
+            {1, 2}, {3, 4}, {7, 8}, {1, 1}, {9, 8}, {5, 4}, {3, 2}, {2, 1},
+        };
+        for(const auto& cache : caches)
+        {
+                for(const auto& [num, den] : FRACTIONS)
+                {
+                        const auto n = cache.size / sizeof(T) * num / den;
+                        if(n >= left && n <= right)
+                        {
+                                sizes.push_back(n);
+                        }
+                }
+        }
+
+        std::sort(sizes.begin(), sizes.end());
+        sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+        return sizes;
+}
+
+/* sysfs CPU lists look like "0-3,8,10-11" */
+inline std::vector<int> parse_cpu_list(const std::string& str)
+{
+        std::vector<int> cpus;
+        std::size_t pos = 0;
+        while(pos < str.size())
+        {
+                auto end = str.find(',', pos);
+                if(end == std::string::npos)
+                {
+                        end = str.size();
+                }
+
+                const auto item = str.substr(pos, end - pos);
+                const auto dash = item.find('-');
+                if(!item.empty() && item[0] >= '0' && item[0] <= '9')
+                {
+                        const int first = std::stoi(item);
+                        int last = first;
+                        if(dash != std::string::npos)
+                        {
+                                last = std::stoi(item.substr(dash + 1));
+                        }
+                        for(int cpu = first; cpu <= last; ++cpu)
+                        {
+                                cpus.push_back(cpu);
+                        }
+                }
+                pos = end + 1;
+        }
+        return cpus;
+}
+
+struct cpu_location
+{
+        int cpu;
+        int package; /* physical_package_id */
+        int core;    /* lowest CPU of this CPU's physical core (itself and its SMT siblings) */
+        int l3;      /* lowest CPU sharing this CPU's last-level cache, -1 if unknown */
+};
+
+/* Where each online CPU sits. Empty if sysfs isn't available. */
+inline std::vector<cpu_location> detect_cpu_locations()
+{
+        std::vector<cpu_location> locations;
+
+        for(const int cpu : parse_cpu_list(read_sysfs_line("/sys/devices/system/cpu/online")))
+        {
+                const auto dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+                const auto package = read_sysfs_line(dir + "/topology/physical_package_id");
+                /* core_id repeats across packages and dies, the sibling lists do not;
+                 * thread_siblings_list is the name before Linux 5.7 */
+                auto siblings = parse_cpu_list(read_sysfs_line(dir + "/topology/core_cpus_list"));
+                if(siblings.empty())
+                {
+                        siblings =
+                            parse_cpu_list(read_sysfs_line(dir + "/topology/thread_siblings_list"));
+                }
+                if(package.empty() || siblings.empty())
+                {
+                        continue;
+                }
+
+                /* the outermost cache level listed is the last-level one */
+                int l3 = -1;
+                unsigned l3_level = 0;
+                for(unsigned idx = 0;; ++idx)
+                {
+                        const auto cache_dir = dir + "/cache/index" + std::to_string(idx);
+                        const auto level = read_sysfs_line(cache_dir + "/level");
+                        if(level.empty())
+                        {
+                                break;
+                        }
+
+                        const auto shared =
+                            parse_cpu_list(read_sysfs_line(cache_dir + "/shared_cpu_list"));
+                        if(unsigned(std::stoul(level)) > l3_level && !shared.empty())
+                        {
+                                l3_level = unsigned(std::stoul(level));
+                                l3 = shared.front();
+                        }
+                }
+
+                locations.push_back({cpu, std::stoi(package), siblings.front(), l3});
+        }
+        return locations;
+}
+
+/* How close two CPUs are, innermost first */
+enum class cpu_distance
+{
+        same_cpu,
+        smt_siblings,    /* same physical core: shared L1 and L2 */
+        same_l3,         /* different cores sharing the last-level cache */
+        same_package,    /* same socket, different last-level caches (e.g. AMD CCXs) */
+        different_package,
+};
+
+inline const char* cpu_distance_name(const cpu_distance distance)
+{
+        switch(distance)
+        {
+        case cpu_distance::same_cpu:
+                return "same CPU";
+        case cpu_distance::smt_siblings:
+                return "SMT siblings";
+        case cpu_distance::same_l3:
+                return "same L3";
+        case cpu_distance::same_package:
+                return "same package, different L3";
+        case cpu_distance::different_package:
+                return "different packages";
+        }
+        return "?";
+}
+
+inline cpu_distance distance_between(const cpu_location& lhs, const cpu_location& rhs)
+{
+        if(lhs.cpu == rhs.cpu)
+        {
+                return cpu_distance::same_cpu;
+        }
+        if(lhs.package != rhs.package)
+        {
+                return cpu_distance::different_package;
+        }
+        if(lhs.core == rhs.core)
+        {
+                return cpu_distance::smt_siblings;
+        }
+        /* without cache information, cores of one package are assumed to share it */
+        if(lhs.l3 < 0 || rhs.l3 < 0 || lhs.l3 == rhs.l3)
+        {
+                return cpu_distance::same_l3;
+        }
+        return cpu_distance::same_package;
+}
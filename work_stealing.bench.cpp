@@ -0,0 +1,138 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_context.hpp"
+#include "cache_padded.hpp"
+#include "dataset.hpp"
+#include "thread_pool.hpp"
+#include "work_stealing.hpp"
+
+static constexpr std::size_t SIZE = 1 << 20;
+
+static constexpr std::uint64_t SEED = 0x5eed;
+
+/* Elements below this value take EXPENSIVE_ROUNDS hash rounds to test, the rest take one: an
+ * eighth of the elements carry ~97% of the work. */
+static constexpr std::uint32_t EXPENSIVE_BELOW = UINT32_MAX / 8;
+static constexpr unsigned EXPENSIVE_ROUNDS = 256;
+
+/* Same total work in expectation; uniform spreads the expensive elements evenly, sorted (even
+ * values ascending, then odd ones) puts them in the first eighth of each half of the range, a
+ * sixteenth of the whole range each */
+static const distribution_params DISTRIBUTIONS[] = {
+    {distribution::uniform},
+    {distribution::sorted},
+};
+
+static const auto test_vecs = []
+{
+        std::vector<dataset<std::uint32_t>> vecs;
+        for(const auto& params : DISTRIBUTIONS)
+        {
+                vecs.push_back(distribution_dataset<std::uint32_t>(SIZE, SEED, params));
+        }
+        return vecs;
+}();
+
+static thread_pool pool;
+
+static work_stealing_scheduler scheduler(pool);
+
+static bool skewed_pred(const std::uint32_t el)
+{
+        const unsigned rounds = el < EXPENSIVE_BELOW ? EXPENSIVE_ROUNDS : 1;
+        std::uint64_t h = el;
+        for(unsigned r = 0; r < rounds; ++r)
+        {
+                h = counter_hash(h, r);
+        }
+        return h % 2 == 0;
+}
+
+static void finish(benchmark::State& state)
+{
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(SIZE));
+        state.SetLabel(distribution_name(DISTRIBUTIONS[state.range(0)]));
+}
+
+static void sequential(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+
+        for(auto _ : state)
+        {
+                const auto tmp = std::count_if(vec.begin(), vec.end(), skewed_pred);
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish(state);
+}
+
+/* One contiguous chunk per worker: the worker holding the expensive elements finishes last */
+static void static_partition(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+        per_thread<std::ptrdiff_t> partial(pool.size());
+
+        for(auto _ : state)
+        {
+                pool.parallel_for(0, vec.size(),
+                                  [&](const std::size_t first, const std::size_t last,
+                                      const std::size_t idx)
+                                  {
+                                          partial[idx] = std::count_if(
+                                              vec.begin() + first, vec.begin() + last, skewed_pred);
+                                  });
+                const auto tmp = partial.combine();
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish(state);
+}
+
+static void work_stealing(benchmark::State& state)
+{
+        const auto& vec = test_vecs[std::size_t(state.range(0))];
+
+        for(auto _ : state)
+        {
+                const auto tmp = parallel_count_if(scheduler, vec.begin(), vec.end(), skewed_pred);
+                benchmark::DoNotOptimize(tmp);
+        }
+
+        finish(state);
+}
+
+/* `init` must be folded in exactly once, whatever the number of workers that got chunks; checked
+ * at startup rather than as a benchmark */
+static const bool init_checked = []()
+{
+        const std::vector<std::uint64_t> ones(100000, 1);
+        const auto identity = [](const std::uint64_t el)
+        {
+                return el;
+        };
+        const auto sum = parallel_transform_reduce(scheduler, ones.begin(), ones.end(),
+                                                   std::uint64_t(10), std::plus<>{}, identity);
+        const auto product = parallel_transform_reduce(scheduler, ones.begin(), ones.end(),
+                                                       std::uint64_t(2), std::multiplies<>{},
+                                                       identity);
+        if(sum != 100010 || product != 2)
+        {
+                std::fprintf(stderr, "parallel_transform_reduce applied `init` more than once\n");
+                std::abort();
+        }
+        return true;
+}();
+
+static constexpr int NUM_DISTRIBUTIONS = int(std::size(DISTRIBUTIONS));
+
+BENCHMARK(sequential)->DenseRange(0, NUM_DISTRIBUTIONS - 1);
+BENCHMARK(static_partition)->DenseRange(0, NUM_DISTRIBUTIONS - 1)->UseRealTime();
+BENCHMARK(work_stealing)->DenseRange(0, NUM_DISTRIBUTIONS - 1)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,265 @@
+#pragma once
+
+/* Work-stealing parallel loops for reductions whose per-element cost is uneven.
+ *
+ * Every worker owns a Chase-Lev deque of index ranges. A worker processes its current range
+ * `grain` elements at a time from the front; whenever its deque is empty (it was stolen from, or
+ * it just started), it first splits the rest of the range in half and pushes the upper half. Idle
+ * workers steal the oldest (largest) range from a random victim. Ranges are only split when
+ * someone may need work, so balanced inputs pay little more than a static partition. */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+
+#include "cache_padded.hpp"
+#include "thread_pool.hpp"
+
+/* Half-open index range packed in one word so that deque slots can be plain atomics */
+struct index_range
+{
+        std::uint32_t first;
+        std::uint32_t last;
+
+        std::uint64_t pack() const
+        {
+                return (std::uint64_t(first) << 32) | last;
+        }
+
+        static index_range unpack(const std::uint64_t word)
+        {
+                return {std::uint32_t(word >> 32), std::uint32_t(word)};
+        }
+
+        std::uint32_t size() const
+        {
+                return last - first;
+        }
+};
+
+/* Fixed-capacity Chase-Lev deque (C11 formulation by Lê, Pop, Cohen and Zappa Nardelli). The
+ * owner pushes and pops at the bottom, thieves steal from the top. With halving splits a worker
+ * never holds more than one range per halving level, so 64 slots can't overflow for 32-bit
+ * indices. */
+class chase_lev_deque
+{
+public:
+        static constexpr std::size_t CAPACITY = 64;
+
+        void push(const index_range range)
+        {
+                const auto b = bottom_.load(std::memory_order_relaxed);
+                slots_[std::size_t(b) % CAPACITY].store(range.pack(), std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+
+        bool pop(index_range& out)
+        {
+                const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+                bottom_.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto t = top_.load(std::memory_order_relaxed);
+
+                if(t > b)
+                {
+                        bottom_.store(b + 1, std::memory_order_relaxed);
+                        return false;
+                }
+
+                out = index_range::unpack(
+                    slots_[std::size_t(b) % CAPACITY].load(std::memory_order_relaxed));
+                if(t == b)
+                {
+                        /* last element: race against the thieves */
+                        const bool won = top_.compare_exchange_strong(
+                            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                        bottom_.store(b + 1, std::memory_order_relaxed);
+                        return won;
+                }
+                return true;
+        }
+
+        bool steal(index_range& out)
+        {
+                auto t = top_.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const auto b = bottom_.load(std::memory_order_acquire);
+                if(t >= b)
+                {
+                        return false;
+                }
+
+                out = index_range::unpack(
+                    slots_[std::size_t(t) % CAPACITY].load(std::memory_order_relaxed));
+                return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+        }
+
+        /* Owner only; a hint, thieves may be taking the last range concurrently */
+        bool empty() const
+        {
+                return bottom_.load(std::memory_order_relaxed) <=
+                       top_.load(std::memory_order_relaxed);
+        }
+
+private:
+        alignas(destructive_interference_size) std::atomic<std::int64_t> top_{0};
+        alignas(destructive_interference_size) std::atomic<std::int64_t> bottom_{0};
+        std::atomic<std::uint64_t> slots_[CAPACITY] = {};
+};
+
+class work_stealing_scheduler
+{
+public:
+        explicit work_stealing_scheduler(thread_pool& pool)
+            : pool_(pool)
+            , deques_(pool.size())
+        {
+        }
+
+        std::size_t size() const
+        {
+                return pool_.size();
+        }
+
+        /* Calls `body(first, last, worker_index)` on disjoint chunks covering [0, n), at most
+         * `grain` elements each (by default n / (64 * workers), at least 256). `n` must fit in
+         * 32 bits. */
+        template<typename Body>
+        void for_each_chunk(const std::size_t n, const Body& body, std::size_t grain = 0)
+        {
+                assert(n <= UINT32_MAX);
+                if(n == 0)
+                {
+                        return;
+                }
+                if(grain == 0)
+                {
+                        grain = std::max<std::size_t>(n / (64 * size()), 256);
+                }
+
+                std::atomic<std::size_t> remaining{n};
+                deques_[0].push({0, std::uint32_t(n)});
+
+                pool_.run(
+                    [&](const std::size_t idx)
+                    {
+                            worker(idx, remaining, grain, body);
+                    });
+        }
+
+private:
+        thread_pool& pool_;
+        per_thread<chase_lev_deque> deques_;
+
+        template<typename Body>
+        void process(const std::size_t idx, index_range range, std::atomic<std::size_t>& remaining,
+                     const std::size_t grain, const Body& body)
+        {
+                auto& own = deques_[idx];
+                while(range.size() != 0)
+                {
+                        if(range.size() > 2 * grain && own.empty())
+                        {
+                                const auto mid = range.first + range.size() / 2;
+                                own.push({mid, range.last});
+                                range.last = mid;
+                                continue;
+                        }
+
+                        const auto chunk_last =
+                            std::uint32_t(std::min<std::size_t>(range.last, range.first + grain));
+                        body(std::size_t(range.first), std::size_t(chunk_last), idx);
+                        remaining.fetch_sub(chunk_last - range.first, std::memory_order_release);
+                        range.first = chunk_last;
+                }
+        }
+
+        template<typename Body>
+        void worker(const std::size_t idx, std::atomic<std::size_t>& remaining,
+                    const std::size_t grain, const Body& body)
+        {
+                /* xorshift, only used to pick victims */
+                std::uint64_t rng = 0x9e3779b97f4a7c15ull * (idx + 1);
+                const auto nworkers = size();
+
+                index_range range;
+                while(remaining.load(std::memory_order_acquire) != 0)
+                {
+                        if(deques_[idx].pop(range))
+                        {
+                                process(idx, range, remaining, grain, body);
+                                continue;
+                        }
+
+                        rng ^= rng << 13;
+                        rng ^= rng >> 7;
+                        rng ^= rng << 17;
+                        const auto victim = std::size_t(rng % nworkers);
+                        if(victim != idx && deques_[victim].steal(range))
+                        {
+                                process(idx, range, remaining, grain, body);
+                                continue;
+                        }
+                        cpu_relax();
+                }
+        }
+};
+
+/* `reduce` over `transform(*it)` for every element, in unspecified order and grouping (so
+ * `reduce` must be associative and commutative). */
+template<typename RandomIt, typename T, typename Reduce, typename Transform>
+T parallel_transform_reduce(work_stealing_scheduler& sched, const RandomIt first,
+                            const RandomIt last, const T init, const Reduce reduce,
+                            const Transform transform, const std::size_t grain = 0)
+{
+        /* empty for the workers that got no chunk */
+        per_thread<std::optional<T>> partial(sched.size());
+
+        sched.for_each_chunk(
+            std::size_t(std::distance(first, last)),
+            [&](const std::size_t chunk_first, const std::size_t chunk_last, const std::size_t idx)
+            {
+                    auto it = first + chunk_first;
+                    T acc = transform(*it);
+                    if(partial[idx])
+                    {
+                            acc = reduce(*partial[idx], acc);
+                    }
+                    for(++it; it != first + chunk_last; ++it)
+                    {
+                            acc = reduce(acc, transform(*it));
+                    }
+                    partial[idx] = acc;
+            },
+            grain);
+
+        /* `init` once, not once per worker */
+        T result = init;
+        for(std::size_t i = 0; i < partial.size(); ++i)
+        {
+                if(partial[i])
+                {
+                        result = reduce(result, *partial[i]);
+                }
+        }
+        return result;
+}
+
+template<typename RandomIt, typename Pred>
+auto parallel_count_if(work_stealing_scheduler& sched, const RandomIt first, const RandomIt last,
+                       const Pred pred, const std::size_t grain = 0)
+{
+        using diff_t = typename std::iterator_traits<RandomIt>::difference_type;
+        return parallel_transform_reduce(sched, first, last, diff_t{0}, std::plus<>{},
+                                         [&pred](const auto& el)
+                                         {
+                                                 return diff_t(pred(el) ? 1 : 0);
+                                         },
+                                         grain);
+}